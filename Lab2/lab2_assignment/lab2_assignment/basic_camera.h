@@ -15,6 +15,8 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include "frustum.h"
+
 class BasicCamera {
 public:
 
@@ -51,6 +53,11 @@ public:
         return glm::lookAt(Position, Position + Direction, Up);
     }
 
+    // Frustum planes of the current view under the given projection
+    Frustum createFrustum(const glm::mat4& projection) {
+        return extractFrustum(projection * createViewMatrix());
+    }
+
     // Update the camera direction based on the current Yaw, Pitch, and Roll
     void updateCameraVectors() {
         // Calculate the new direction vector
@@ -0,0 +1,835 @@
+#pragma once
+//
+//  benchmarks.h
+//  3D Object Drawing
+//
+//  Benchmarks run with "lab2_assignment --bench <name>" (or "--bench all")
+//  after the GL context is created; results are printed to stdout.
+//
+
+#ifndef BENCHMARKS_H
+#define BENCHMARKS_H
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "shader.h"
+#include "mesh_cache.h"
+#include "cube_renderer.h"
+#include "frame_uniforms.h"
+#include "transform_math.h"
+#include "draw_list.h"
+#include "frustum.h"
+#include "occlusion.h"
+#include "scene_file.h"
+#include "gl_trace.h"
+#include "image_diff.h"
+#include "soft_raster.h"
+#include "lab1_shapes.h"
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstdio>
+#include <chrono>
+#include <random>
+#include <iostream>
+#include <iomanip>
+#include <cmath>
+#include <algorithm>
+#include <thread>
+
+// everything a benchmark may need from main()
+struct BenchContext
+{
+    GLFWwindow* window;
+    Shader* cubeShader;
+    Shader* instancedShader;
+    Shader* staticShader;
+    MeshCache* meshCache;
+    MeshHandle cubeMesh;
+    FrameUniformBuffer* frameUniforms;
+};
+
+class BenchTimer
+{
+public:
+    BenchTimer() : start(std::chrono::high_resolution_clock::now()) {}
+
+    double elapsedMs() const
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    }
+
+private:
+    std::chrono::high_resolution_clock::time_point start;
+};
+
+struct FrameTiming
+{
+    int frames;
+    double submitMs;    // mean CPU time spent issuing the frame
+    double frameMs;     // mean CPU time until the GPU finished the frame
+    size_t glCalls;     // GL calls of one frame, when "--gl-trace" is on
+};
+
+// runs frame() repeatedly (at least 3 frames, at most 50 or ~2 seconds) and averages its cost
+// ------------------------------------------------------------------------
+template <class FrameFunc>
+FrameTiming measureFrames(FrameFunc frame)
+{
+    FrameTiming timing = { 0, 0.0, 0.0, 0 };
+
+    // warm-up frame so buffer allocations are not measured
+    frame();
+    glFinish();
+
+    BenchTimer total;
+    while (timing.frames < 3 || (timing.frames < 50 && total.elapsedMs() < 2000.0))
+    {
+        BenchTimer frameTimer;
+        size_t callsBefore = glTrace().callsThisFrame();
+        frame();
+        timing.submitMs += frameTimer.elapsedMs();
+        timing.glCalls = glTrace().callsThisFrame() - callsBefore;
+        glFinish();
+        timing.frameMs += frameTimer.elapsedMs();
+        timing.frames++;
+    }
+    timing.submitMs /= timing.frames;
+    timing.frameMs /= timing.frames;
+    return timing;
+}
+
+// drawCube() per cube vs. one glDrawElementsInstanced for the whole batch
+// ------------------------------------------------------------------------
+inline void benchmarkInstancing(BenchContext& ctx)
+{
+    struct BenchCube
+    {
+        glm::vec3 position, rotation, scale;
+        glm::vec4 color;
+    };
+
+    const size_t counts[] = { 40, 4000, 400000 };
+    unsigned int VAO = ctx.meshCache->get(ctx.cubeMesh).VAO;
+
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 500.0f);
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 60.0f, 120.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    ctx.frameUniforms->update(view, projection, glm::vec3(0.0f, 60.0f, 120.0f), 0.0f);
+
+    InstancedCubeRenderer renderer;
+    renderer.init(ctx.meshCache->get(ctx.cubeMesh));
+
+    std::mt19937 rng(4208);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+    std::cout << "instancing benchmark" << std::endl;
+    std::cout << std::setw(10) << "cubes" << std::setw(12) << "path" << std::setw(12) << "draws"
+        << std::setw(14) << "submit ms" << std::setw(14) << "frame ms";
+    if (glTrace().installed)
+        std::cout << std::setw(16) << "GL calls/cube";
+    std::cout << std::endl;
+
+    for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++)
+    {
+        size_t count = counts[c];
+        std::vector<BenchCube> cubes(count);
+        for (size_t i = 0; i < count; i++)
+        {
+            cubes[i].position = glm::vec3(unit(rng) * 100.0f - 50.0f, unit(rng) * 20.0f, unit(rng) * 100.0f - 50.0f);
+            cubes[i].rotation = glm::vec3(unit(rng) * 360.0f, unit(rng) * 360.0f, unit(rng) * 360.0f);
+            cubes[i].scale = glm::vec3(0.2f + unit(rng), 0.2f + unit(rng), 0.2f + unit(rng));
+            cubes[i].color = glm::vec4(unit(rng), unit(rng), unit(rng), 1.0f);
+        }
+        glm::mat4 identity(1.0f);
+
+        FrameTiming legacy = measureFrames([&]() {
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            for (size_t i = 0; i < count; i++)
+            {
+                const BenchCube& b = cubes[i];
+                drawCube(*ctx.cubeShader, VAO, identity, b.position.x, b.position.y, b.position.z,
+                    b.rotation.x, b.rotation.y, b.rotation.z, b.scale.x, b.scale.y, b.scale.z, b.color);
+            }
+        });
+
+        std::vector<CubeInstance> instances;
+        instances.reserve(count);
+        FrameTiming instanced = measureFrames([&]() {
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            instances.clear();
+            for (size_t i = 0; i < count; i++)
+            {
+                const BenchCube& b = cubes[i];
+                addCube(instances, identity, b.position.x, b.position.y, b.position.z,
+                    b.rotation.x, b.rotation.y, b.rotation.z, b.scale.x, b.scale.y, b.scale.z, b.color);
+            }
+            ctx.instancedShader->use();
+            renderer.draw(instances);
+            renderer.endFrame();
+        });
+
+        std::cout << std::fixed << std::setprecision(3);
+        std::cout << std::setw(10) << count << std::setw(12) << "drawCube" << std::setw(12) << count
+            << std::setw(14) << legacy.submitMs << std::setw(14) << legacy.frameMs;
+        if (glTrace().installed)
+            std::cout << std::setw(16) << (double)legacy.glCalls / count;
+        std::cout << std::endl;
+        std::cout << std::setw(10) << count << std::setw(12) << "instanced" << std::setw(12) << 1
+            << std::setw(14) << instanced.submitMs << std::setw(14) << instanced.frameMs;
+        if (glTrace().installed)
+            std::cout << std::setw(16) << (double)instanced.glCalls / count;
+        std::cout << std::endl;
+    }
+    renderer.instanceStream.printStats();
+
+    renderer.clear();
+}
+
+// glm translate/rotate/scale chain vs. composeTRS vs. the SoA composeTRSBatch (CPU only)
+// ------------------------------------------------------------------------
+inline void benchmarkTRS(BenchContext&)
+{
+    const size_t count = 100000;
+    const int repeats = 20;
+
+    std::mt19937 rng(4208);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::vector<float> px(count), py(count), pz(count), rx(count), ry(count), rz(count), sx(count), sy(count), sz(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        px[i] = unit(rng) * 10.0f - 5.0f; py[i] = unit(rng) * 3.0f; pz[i] = unit(rng) * 10.0f - 5.0f;
+        rx[i] = unit(rng) * 360.0f; ry[i] = unit(rng) * 360.0f; rz[i] = unit(rng) * 360.0f;
+        sx[i] = 0.1f + unit(rng) * 2.0f; sy[i] = 0.1f + unit(rng) * 2.0f; sz[i] = 0.1f + unit(rng) * 2.0f;
+    }
+    glm::mat4 parent = glm::rotate(glm::translate(glm::mat4(1.0f), glm::vec3(0.5f, 0.0f, -0.5f)), glm::radians(30.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+    std::vector<glm::mat4> reference(count), single(count), batch(count);
+
+    BenchTimer chainTimer;
+    for (int r = 0; r < repeats; r++)
+        for (size_t i = 0; i < count; i++)
+            reference[i] = cubeModelMatrixChain(parent, px[i], py[i], pz[i], rx[i], ry[i], rz[i], sx[i], sy[i], sz[i]);
+    double chainMs = chainTimer.elapsedMs();
+
+    BenchTimer singleTimer;
+    for (int r = 0; r < repeats; r++)
+        for (size_t i = 0; i < count; i++)
+            single[i] = composeTRS(parent, glm::vec3(px[i], py[i], pz[i]), glm::vec3(rx[i], ry[i], rz[i]), glm::vec3(sx[i], sy[i], sz[i]), CUBE_PIVOT);
+    double singleMs = singleTimer.elapsedMs();
+
+    TRSArrays arrays = { px.data(), py.data(), pz.data(), rx.data(), ry.data(), rz.data(), sx.data(), sy.data(), sz.data() };
+    BenchTimer batchTimer;
+    for (int r = 0; r < repeats; r++)
+        composeTRSBatch(parent, arrays, CUBE_PIVOT, count, batch.data());
+    double batchMs = batchTimer.elapsedMs();
+
+    float singleError = 0.0f, batchError = 0.0f;
+    for (size_t i = 0; i < count; i++)
+        for (int c = 0; c < 4; c++)
+            for (int r = 0; r < 4; r++)
+            {
+                singleError = std::max(singleError, std::fabs(single[i][c][r] - reference[i][c][r]));
+                batchError = std::max(batchError, std::fabs(batch[i][c][r] - reference[i][c][r]));
+            }
+
+    double matrices = double(count) * repeats;
+    std::cout << "TRS benchmark (" << count << " matrices x " << repeats << ")" << std::endl;
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << std::setw(18) << "glm chain" << std::setw(10) << chainMs * 1.0e6 / matrices << " ns/matrix" << std::endl;
+    std::cout << std::setw(18) << "composeTRS" << std::setw(10) << singleMs * 1.0e6 / matrices << " ns/matrix"
+        << "  max error " << std::scientific << singleError << std::fixed << std::endl;
+    std::cout << std::setw(18) << "composeTRSBatch" << std::setw(10) << batchMs * 1.0e6 / matrices << " ns/matrix"
+        << "  max error " << std::scientific << batchError << std::fixed << std::endl;
+}
+
+// the same draws submitted in record order vs. radix-sorted by key; also times the sort against std::sort
+// ------------------------------------------------------------------------
+inline void benchmarkDrawList(BenchContext& ctx)
+{
+    const size_t count = 20000;
+    const unsigned int materials = 16;
+
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 500.0f);
+    glm::vec3 eye(0.0f, 60.0f, 120.0f);
+    glm::mat4 view = glm::lookAt(eye, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    ctx.frameUniforms->update(view, projection, eye, 0.0f);
+
+    // two programs x two meshes x 16 colors, interleaved at random like a hand-written scene
+    const Shader* programs[2] = { ctx.cubeShader, ctx.staticShader };
+    UniformMat4 models[2] = { ctx.cubeShader->uniform<glm::mat4>("model"), ctx.staticShader->uniform<glm::mat4>("model") };
+    UniformVec4 colorUniform = ctx.cubeShader->uniform<glm::vec4>("color");
+    // acquire everything before taking references into the cache
+    MeshHandle cylinderMesh = ctx.meshCache->acquire(PRIMITIVE_CYLINDER, 36, 0.3f, 0.05f);
+    const Mesh* meshes[2] = { &ctx.meshCache->get(ctx.cubeMesh), &ctx.meshCache->get(cylinderMesh) };
+
+    std::mt19937 rng(4208);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::vector<DrawCommand> commands(count);
+    std::vector<unsigned int> commandMaterials(count);
+    std::vector<float> depths(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        int p = (int)(unit(rng) * 2.0f) & 1;
+        int m = (int)(unit(rng) * 2.0f) & 1;
+        unsigned int material = (unsigned int)(unit(rng) * materials) % materials;
+        glm::vec3 position(unit(rng) * 100.0f - 50.0f, unit(rng) * 20.0f, unit(rng) * 100.0f - 50.0f);
+
+        DrawCommand command = makeDrawCommand(*programs[p], meshes[m]->VAO, GL_TRIANGLES, meshes[m]->indexCount, true);
+        command.modelUniform = models[p];
+        command.model = glm::translate(glm::mat4(1.0f), position);
+        if (p == 0)
+        {
+            command.colorUniform = colorUniform;
+            command.color = glm::vec4(material / float(materials), 0.5f, 1.0f - material / float(materials), 1.0f);
+        }
+        commands[i] = command;
+        commandMaterials[i] = material;
+        depths[i] = viewDepth(view, position);
+    }
+
+    DrawList list;
+    list.setDepthRange(0.1f, 500.0f);
+    for (size_t i = 0; i < count; i++)
+        list.add(PASS_OPAQUE, commandMaterials[i], depths[i], commands[i]);
+
+    std::cout << "draw list benchmark (" << count << " draws)" << std::endl;
+    std::cout << std::setw(10) << "order" << std::setw(12) << "programs" << std::setw(10) << "VAOs"
+        << std::setw(12) << "materials" << std::setw(12) << "GL state" << std::setw(14) << "submit ms" << std::setw(14) << "frame ms" << std::endl;
+
+    const char* names[2] = { "recorded", "sorted" };
+    for (int sorted = 0; sorted < 2; sorted++)
+    {
+        if (sorted)
+            list.sort();
+        size_t stateCalls = 0;
+        FrameTiming timing = measureFrames([&]() {
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            glState().beginFrame();
+            list.submit();
+            stateCalls = glState().issued;
+        });
+        std::cout << std::fixed << std::setprecision(3);
+        std::cout << std::setw(10) << names[sorted] << std::setw(12) << list.programSwitches << std::setw(10) << list.vertexArraySwitches
+            << std::setw(12) << list.materialChanges << std::setw(12) << stateCalls
+            << std::setw(14) << timing.submitMs << std::setw(14) << timing.frameMs << std::endl;
+    }
+
+    // sort cost alone, on freshly shuffled keys every repeat
+    const int repeats = 50;
+    std::vector<SortEntry> keys(count), work, scratch;
+    for (size_t i = 0; i < count; i++)
+    {
+        keys[i].key = makeSortKey(PASS_OPAQUE, commands[i].shader->ID, commands[i].VAO, commandMaterials[i], depthBucket(depths[i], 0.1f, 500.0f));
+        keys[i].index = (unsigned int)i;
+    }
+    double radixMs = 0.0, stdMs = 0.0;
+    for (int r = 0; r < repeats; r++)
+    {
+        work = keys;
+        BenchTimer radixTimer;
+        radixSort(work, scratch);
+        radixMs += radixTimer.elapsedMs();
+
+        work = keys;
+        BenchTimer stdTimer;
+        std::stable_sort(work.begin(), work.end(), [](const SortEntry& a, const SortEntry& b) { return a.key < b.key; });
+        stdMs += stdTimer.elapsedMs();
+    }
+    std::cout << std::setw(18) << "radixSort" << std::setw(10) << radixMs / repeats << " ms" << std::endl;
+    std::cout << std::setw(18) << "std::stable_sort" << std::setw(10) << stdMs / repeats << " ms" << std::endl;
+}
+
+// frustum culling of 100k cube instances: scalar vs. SSE2 plane tests, then frames drawn with and without culling
+// ------------------------------------------------------------------------
+inline void benchmarkCulling(BenchContext& ctx)
+{
+    const size_t count = 100000;
+    const int repeats = 20;
+
+    glm::vec3 eye(0.0f, 10.0f, 0.0f);
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 500.0f);
+    glm::mat4 view = glm::lookAt(eye, glm::vec3(50.0f, 0.0f, -50.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    ctx.frameUniforms->update(view, projection, eye, 0.0f);
+    Frustum frustum = extractFrustum(projection * view);
+
+    std::mt19937 rng(4208);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::vector<CubeInstance> instances;
+    glm::mat4 identity(1.0f);
+    for (size_t i = 0; i < count; i++)
+        addCube(instances, identity, unit(rng) * 400.0f - 200.0f, unit(rng) * 20.0f, unit(rng) * 400.0f - 200.0f,
+            unit(rng) * 360.0f, unit(rng) * 360.0f, unit(rng) * 360.0f, 0.2f + unit(rng), 0.2f + unit(rng), 0.2f + unit(rng),
+            glm::vec4(unit(rng), unit(rng), unit(rng), 1.0f));
+
+    const AABB& cubeBounds = ctx.meshCache->get(ctx.cubeMesh).bounds;
+    std::vector<AABB> worldBoxes(count);
+    AABBArrays boxes;
+    boxes.resize(count);
+    BenchTimer boundsTimer;
+    for (size_t i = 0; i < count; i++)
+    {
+        worldBoxes[i] = transformAABB(cubeBounds, instances[i].model);
+        boxes.set(i, worldBoxes[i]);
+    }
+    double boundsMs = boundsTimer.elapsedMs();
+
+    size_t scalarVisible = 0;
+    BenchTimer scalarTimer;
+    for (int r = 0; r < repeats; r++)
+    {
+        scalarVisible = 0;
+        for (size_t i = 0; i < count; i++)
+            scalarVisible += isVisible(frustum, worldBoxes[i]) ? 1 : 0;
+    }
+    double scalarMs = scalarTimer.elapsedMs() / repeats;
+
+    std::vector<unsigned int> visible;
+    size_t simdVisible = 0;
+    BenchTimer simdTimer;
+    for (int r = 0; r < repeats; r++)
+        simdVisible = cullAABBs(frustum, boxes, count, visible);
+    double simdMs = simdTimer.elapsedMs() / repeats;
+
+    InstancedCubeRenderer renderer;
+    renderer.init(ctx.meshCache->get(ctx.cubeMesh));
+    std::vector<CubeInstance> frameInstances;
+    FrameTiming unculled = measureFrames([&]() {
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        ctx.instancedShader->use();
+        renderer.draw(instances);
+        renderer.endFrame();
+    });
+    FrameTiming culled = measureFrames([&]() {
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        frameInstances = instances;
+        renderer.cull(frustum, frameInstances);
+        ctx.instancedShader->use();
+        renderer.draw(frameInstances);
+        renderer.endFrame();
+    });
+    renderer.clear();
+
+    std::cout << "culling benchmark (" << count << " instances)" << std::endl;
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << std::setw(22) << "world bounds" << std::setw(10) << boundsMs << " ms" << std::endl;
+    std::cout << std::setw(22) << "scalar plane test" << std::setw(10) << scalarMs << " ms  " << scalarVisible << " visible" << std::endl;
+    std::cout << std::setw(22) << "SSE2 plane test" << std::setw(10) << simdMs << " ms  " << simdVisible << " visible" << std::endl;
+    std::cout << std::setw(22) << "frame, no culling" << std::setw(10) << unculled.frameMs << " ms  " << count << " drawn" << std::endl;
+    std::cout << std::setw(22) << "frame, culled" << std::setw(10) << culled.frameMs << " ms  " << frameInstances.size() << " drawn" << std::endl;
+}
+
+// occlusion culling in an 8x8 grid of closed rooms with the camera in one of them: frustum-only vs.
+// frustum + occlusion, with the CPU cost of the occluder raster and the box tests
+// ------------------------------------------------------------------------
+inline void benchmarkOcclusion(BenchContext& ctx)
+{
+    const int rooms = 8;
+    const float roomSize = 6.0f;
+    const size_t count = 50000;
+
+    glm::vec3 eye(0.5f * roomSize, 1.5f, 0.5f * roomSize);
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 100.0f);
+    glm::mat4 view = glm::lookAt(eye, eye + glm::vec3(1.0f, -0.2f, 1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    ctx.frameUniforms->update(view, projection, eye, 0.0f);
+    Frustum frustum = extractFrustum(projection * view);
+
+    // two walls per cell plus the outer boundary close every room; the cube mesh spans 0.5 units
+    std::vector<glm::mat4> walls;
+    float thickness = 0.1f, height = 3.0f;
+    for (int i = 0; i <= rooms; i++)
+        for (int j = 0; j < rooms; j++)
+        {
+            walls.push_back(composeTRS(glm::vec3(i * roomSize, height * 0.5f, (j + 0.5f) * roomSize), glm::vec3(0.0f),
+                glm::vec3(thickness, height, roomSize) * 2.0f, CUBE_PIVOT));
+            walls.push_back(composeTRS(glm::vec3((j + 0.5f) * roomSize, height * 0.5f, i * roomSize), glm::vec3(0.0f),
+                glm::vec3(roomSize, height, thickness) * 2.0f, CUBE_PIVOT));
+        }
+
+    std::mt19937 rng(4208);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::vector<CubeInstance> instances;
+    glm::mat4 identity(1.0f);
+    for (size_t i = 0; i < count; i++)
+        addCube(instances, identity, unit(rng) * rooms * roomSize, 0.2f + unit(rng) * 2.0f, unit(rng) * rooms * roomSize,
+            0.0f, unit(rng) * 360.0f, 0.0f, 0.3f, 0.3f, 0.3f, glm::vec4(unit(rng), unit(rng), unit(rng), 1.0f));
+
+    const Mesh& cube = ctx.meshCache->get(ctx.cubeMesh);
+    OcclusionBuffer occlusion;
+    occlusion.init();
+    InstancedCubeRenderer renderer;
+    renderer.init(cube);
+    std::vector<CubeInstance> frameInstances;
+
+    FrameTiming frustumOnly = measureFrames([&]() {
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        frameInstances = instances;
+        renderer.cull(frustum, frameInstances);
+        ctx.instancedShader->use();
+        renderer.draw(frameInstances);
+        renderer.endFrame();
+    });
+    size_t frustumVisible = frameInstances.size();
+
+    FrameTiming withOcclusion = measureFrames([&]() {
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        occlusion.begin(projection * view);
+        for (size_t i = 0; i < walls.size(); i++)
+            occlusion.addOccluder(cube.vertices, cube.indices, walls[i]);
+        occlusion.finish();
+        frameInstances = instances;
+        renderer.cull(frustum, frameInstances);
+        renderer.cullOccluded(occlusion, frameInstances);
+        occlusion.endFrame();
+        ctx.instancedShader->use();
+        renderer.draw(frameInstances);
+        renderer.endFrame();
+    });
+    renderer.clear();
+
+    std::cout << "occlusion benchmark (" << rooms << "x" << rooms << " rooms, " << walls.size() << " occluders, " << count << " instances)" << std::endl;
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << std::setw(22) << "frustum only" << std::setw(10) << frustumOnly.frameMs << " ms  " << frustumVisible << " drawn" << std::endl;
+    std::cout << std::setw(22) << "frustum + occlusion" << std::setw(10) << withOcclusion.frameMs << " ms  " << frameInstances.size() << " drawn" << std::endl;
+    std::cout << std::setw(22) << "rejection rate" << std::setw(10) << 100.0 * occlusion.occluded / std::max<size_t>(occlusion.tested, 1) << " %" << std::endl;
+    std::cout << std::setw(22) << "occluder raster" << std::setw(10) << occlusion.rasterMs << " ms" << std::endl;
+    std::cout << std::setw(22) << "box tests" << std::setw(10) << occlusion.testMs << " ms" << std::endl;
+}
+
+// a 1M-node scene: text compile time vs. opening the compiled file and walking its nodes (CPU only)
+// ------------------------------------------------------------------------
+inline void benchmarkScene(BenchContext&)
+{
+    const size_t count = 1000000;
+    const char* textPath = "bench_scene.scene";
+    const char* binaryPath = "bench_scene.sceneb";
+
+    {
+        std::mt19937 rng(4208);
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+        std::ofstream text(textPath);
+        text << "node root - 0 0 0 0 0 0 1 1 1\n";
+        for (size_t i = 1; i < count; i++)
+            text << "cube - root " << unit(rng) * 100.0f << " " << unit(rng) * 3.0f << " " << unit(rng) * 100.0f << " 0 "
+                << unit(rng) * 360.0f << " 0 0.3 0.3 0.3 " << unit(rng) << " " << unit(rng) << " " << unit(rng) << " 1 static\n";
+    }
+
+    BenchTimer compileTimer;
+    bool compiled = compileScene(textPath, binaryPath);
+    double compileMs = compileTimer.elapsedMs();
+
+    SceneFile scene;
+    BenchTimer openTimer;
+    bool opened = compiled && scene.open(binaryPath);
+    double openMs = openTimer.elapsedMs();
+
+    // touch every record the way an instantiation pass would
+    BenchTimer walkTimer;
+    AABB bounds = emptyAABB();
+    for (uint32_t i = 0; opened && i < scene.size(); i++)
+        growAABB(bounds, scene.node(i).getPosition());
+    double walkMs = walkTimer.elapsedMs();
+
+    std::cout << "scene benchmark (" << count << " nodes, " << scene.bytes() << " bytes)" << std::endl;
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << std::setw(22) << "compile text" << std::setw(12) << compileMs << " ms" << std::endl;
+    std::cout << std::setw(22) << "open (map + validate)" << std::setw(12) << openMs << " ms" << std::endl;
+    std::cout << std::setw(22) << "walk nodes" << std::setw(12) << walkMs << " ms  bounds x " << bounds.min.x << ".." << bounds.max.x << std::endl;
+
+    scene.close();
+    std::remove(textPath);
+    std::remove(binaryPath);
+}
+
+// golden-image comparison of 1080p frames: a scalar pixel loop vs. diffImages on one thread and on a worker pool (CPU only)
+// ------------------------------------------------------------------------
+inline void benchmarkImageDiff(BenchContext&)
+{
+    const int width = 1920, height = 1080;
+    const int repeats = 20;
+
+    // a smooth frame, and a copy with rounding noise everywhere and one region that really changed
+    std::mt19937 rng(4208);
+    std::uniform_int_distribution<int> noise(-2, 2);
+    Image expected, actual;
+    expected.resize(width, height);
+    actual.resize(width, height);
+    for (int y = 0; y < height; y++)
+        for (int x = 0; x < width; x++)
+        {
+            uint8_t* e = expected.row(y) + x * 4;
+            uint8_t* a = actual.row(y) + x * 4;
+            e[0] = (uint8_t)(x * 255 / width);
+            e[1] = (uint8_t)(y * 255 / height);
+            e[2] = (uint8_t)((x + y) & 0xFF);
+            e[3] = 255;
+            bool changed = x >= 900 && x < 960 && y >= 500 && y < 540;
+            for (int c = 0; c < 3; c++)
+                a[c] = changed ? (uint8_t)(255 - e[c]) : (uint8_t)std::min(255, std::max(0, e[c] + noise(rng)));
+            a[3] = 255;
+        }
+    ImageDiffOptions options;
+
+    BenchTimer scalarTimer;
+    size_t scalarBad = 0;
+    for (int r = 0; r < repeats; r++)
+    {
+        scalarBad = 0;
+        for (int y = 0; y < height; y++)
+            for (int x = 0; x < width; x++)
+                if (pixelDiff(expected.row(y) + x * 4, actual.row(y) + x * 4) > options.tolerance)
+                    scalarBad++;
+    }
+    double scalarMs = scalarTimer.elapsedMs() / repeats;
+
+    ImageDiffResult serial;
+    BenchTimer serialTimer;
+    for (int r = 0; r < repeats; r++)
+        serial = diffImages(expected, actual, options);
+    double serialMs = serialTimer.elapsedMs() / repeats;
+
+    WorkerPool pool;
+    pool.start();
+    ImageDiffResult parallel;
+    BenchTimer parallelTimer;
+    for (int r = 0; r < repeats; r++)
+        parallel = diffImages(expected, actual, options, &pool);
+    double parallelMs = parallelTimer.elapsedMs() / repeats;
+    size_t threads = pool.size() + 1;
+    pool.stop();
+
+    std::cout << "image diff benchmark (" << width << "x" << height << ", tolerance " << options.tolerance << ")" << std::endl;
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << std::setw(26) << "scalar pixel count" << std::setw(10) << scalarMs << " ms  " << scalarBad << " bad" << std::endl;
+    std::cout << std::setw(26) << "diffImages, 1 thread" << std::setw(10) << serialMs << " ms  " << serial.badPixels
+        << " bad, SSIM " << serial.ssim << ", PSNR " << serial.psnr << " dB" << std::endl;
+    std::cout << std::setw(26) << ("diffImages, " + std::to_string(threads) + " threads") << std::setw(10)
+        << parallelMs << " ms  " << parallel.badPixels << " bad; " << 500.0 * parallelMs / 1000.0 << " s per 500 images" << std::endl;
+}
+
+// the software rasterizer on a field of cubes at 1280x720, on 1, 2, 4, ... threads up to every core (CPU only)
+// ------------------------------------------------------------------------
+inline void benchmarkSoftRaster(BenchContext& ctx)
+{
+    const int width = 1280, height = 720;
+    const size_t count = 20000;
+    const int frames = 10;
+
+    std::mt19937 rng(4208);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::vector<CubeInstance> instances;
+    glm::mat4 identity(1.0f);
+    for (size_t i = 0; i < count; i++)
+        addCube(instances, identity, unit(rng) * 20.0f - 10.0f, unit(rng) * 4.0f, -unit(rng) * 20.0f,
+            unit(rng) * 360.0f, unit(rng) * 360.0f, 0.0f, 0.3f, 0.3f, 0.3f, glm::vec4(unit(rng), unit(rng), unit(rng), 1.0f));
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f), (float)width / height, 0.1f, 100.0f);
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 2.0f, 4.0f), glm::vec3(0.0f, 1.5f, -10.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 viewProjection = projection * view;
+    const Mesh& cube = ctx.meshCache->get(ctx.cubeMesh);
+
+    std::vector<unsigned int> threadCounts;
+    unsigned int cores = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned int t = 1; t < cores; t *= 2)
+        threadCounts.push_back(t);
+    threadCounts.push_back(cores);
+
+    std::cout << "software raster benchmark (" << width << "x" << height << ", " << count << " cubes, "
+        << count * cube.indices.size() / 3 << " triangles)" << std::endl;
+    std::cout << std::setw(10) << "threads" << std::setw(12) << "ms/frame" << std::setw(12) << "Mtri/s"
+        << std::setw(14) << "Mpixel/s" << std::setw(10) << "speedup" << std::endl;
+    std::cout << std::fixed << std::setprecision(3);
+    double baseMs = 0.0;
+    Image reference;
+    bool identical = true;
+    for (size_t t = 0; t < threadCounts.size(); t++)
+    {
+        SoftwareRasterizer raster;
+        raster.init(width, height, threadCounts[t]);
+        auto frame = [&]() {
+            raster.beginFrame(glm::vec4(0.2f, 0.3f, 0.3f, 1.0f));
+            for (size_t i = 0; i < instances.size(); i++)
+                raster.drawIndexed(cube.vertices, cube.indices, instances[i].model, viewProjection, &instances[i].color);
+            raster.finish();
+        };
+        frame();
+        BenchTimer timer;
+        for (int f = 0; f < frames; f++)
+            frame();
+        double ms = timer.elapsedMs() / frames;
+        if (t == 0)
+        {
+            baseMs = ms;
+            reference = raster.color;
+        }
+        else
+            identical = identical && raster.color.rgba == reference.rgba;
+        std::cout << std::setw(10) << raster.threads() << std::setw(12) << ms << std::setw(12) << raster.triangles / ms / 1000.0
+            << std::setw(14) << raster.pixels / ms / 1000.0 << std::setw(9) << baseMs / ms << "x" << std::endl;
+        raster.clear();
+    }
+    std::cout << "  images " << (identical ? "identical" : "DIFFER") << " across thread counts" << std::endl;
+}
+
+// a Lab1 outline as 6-float vertices in one color, indexed as the triangles of its fan
+// ------------------------------------------------------------------------
+inline void addFanMesh(const float* positions, int count, const glm::vec3& color,
+    std::vector<float>& vertices, std::vector<unsigned int>& indices)
+{
+    vertices.clear();
+    for (int v = 0; v < count; v++)
+    {
+        vertices.insert(vertices.end(), positions + v * 3, positions + v * 3 + 3);
+        vertices.insert(vertices.end(), { color.r, color.g, color.b });
+    }
+    fanIndices(count, indices);
+}
+
+// the raster kernels on one thread: Lab2's cubes and stacks of Lab1's fans at three sizes,
+// scalar vs. every SIMD kernel this CPU runs; times only the raster stage (CPU only)
+// ------------------------------------------------------------------------
+inline void benchmarkRasterKernels(BenchContext& ctx)
+{
+    const int sizes[3][2] = { { 640, 360 }, { 1280, 720 }, { 1920, 1080 } };
+    const size_t cubeCount = 2000;
+    const int fanLayers = 16;
+    const int frames = 5;
+
+    std::mt19937 rng(4208);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::vector<CubeInstance> instances;
+    glm::mat4 identity(1.0f);
+    for (size_t i = 0; i < cubeCount; i++)
+        addCube(instances, identity, unit(rng) * 20.0f - 10.0f, unit(rng) * 4.0f, -unit(rng) * 20.0f,
+            unit(rng) * 360.0f, unit(rng) * 360.0f, 0.0f, 0.6f, 0.6f, 0.6f, glm::vec4(unit(rng), unit(rng), unit(rng), 1.0f));
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 2.0f, 4.0f), glm::vec3(0.0f, 1.5f, -10.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    const Mesh& cube = ctx.meshCache->get(ctx.cubeMesh);
+
+    // Lab1 draws in clip space; each layer is turned a little and sits nearer than the last
+    std::vector<float> triangleVertices, squareVertices;
+    std::vector<unsigned int> triangleIndices, squareIndices;
+    addFanMesh(LAB1_TRIANGLE_VERTICES, LAB1_TRIANGLE_FAN_COUNT, glm::vec3(1.0f, 0.0f, 0.0f), triangleVertices, triangleIndices);
+    addFanMesh(LAB1_SQUARE_VERTICES, LAB1_SQUARE_FAN_COUNT, glm::vec3(1.0f, 1.0f, 0.0f), squareVertices, squareIndices);
+    std::vector<glm::mat4> layers;
+    for (int l = 0; l < fanLayers; l++)
+    {
+        glm::mat4 model = glm::translate(identity, glm::vec3(0.0f, 0.0f, 0.9f - 1.8f * l / fanLayers));
+        layers.push_back(glm::rotate(model, glm::radians(22.5f * l), glm::vec3(0.0f, 0.0f, 1.0f)));
+    }
+
+    std::vector<RasterKernel> kernels;
+    for (int k = RASTER_KERNEL_SCALAR; k <= detectRasterKernel(); k++)
+        kernels.push_back((RasterKernel)k);
+
+    std::cout << "raster kernel benchmark (1 thread, raster stage only; " << cubeCount << " cubes, "
+        << fanLayers << " layers of Lab1 fans)" << std::endl;
+    std::cout << std::setw(8) << "scene" << std::setw(12) << "size" << std::setw(10) << "kernel" << std::setw(12) << "ms/frame"
+        << std::setw(12) << "Mtri/s" << std::setw(14) << "Mpixel/s" << std::setw(10) << "speedup" << std::endl;
+    std::cout << std::fixed << std::setprecision(3);
+    bool identical = true;
+    for (int scene = 0; scene < 2; scene++)
+        for (int s = 0; s < 3; s++)
+        {
+            int width = sizes[s][0], height = sizes[s][1];
+            glm::mat4 viewProjection = glm::perspective(glm::radians(45.0f), (float)width / height, 0.1f, 100.0f) * view;
+            double scalarMs = 0.0;
+            Image reference;
+            for (size_t k = 0; k < kernels.size(); k++)
+            {
+                SoftwareRasterizer raster;
+                raster.init(width, height, 1);
+                raster.kernel = kernels[k];
+                auto frame = [&]() {
+                    raster.beginFrame(glm::vec4(0.2f, 0.3f, 0.3f, 1.0f));
+                    if (scene == 0)
+                        for (size_t i = 0; i < instances.size(); i++)
+                            raster.drawIndexed(cube.vertices, cube.indices, instances[i].model, viewProjection, &instances[i].color);
+                    else
+                        for (size_t l = 0; l < layers.size(); l++)
+                        {
+                            raster.drawIndexed(triangleVertices, triangleIndices, layers[l], identity);
+                            raster.drawIndexed(squareVertices, squareIndices, layers[l], identity);
+                        }
+                    raster.finish();
+                };
+                frame();
+                raster.totalRasterMs = 0.0;
+                for (int f = 0; f < frames; f++)
+                    frame();
+                double ms = raster.totalRasterMs / frames;
+                if (k == 0)
+                {
+                    scalarMs = ms;
+                    reference = raster.color;
+                }
+                else
+                    identical = identical && raster.color.rgba == reference.rgba;
+                std::cout << std::setw(8) << (scene == 0 ? "cubes" : "fans") << std::setw(12)
+                    << (std::to_string(width) + "x" + std::to_string(height)) << std::setw(10) << rasterKernelName(kernels[k])
+                    << std::setw(12) << ms << std::setw(12) << raster.binned / ms / 1000.0 << std::setw(14) << raster.pixels / ms / 1000.0
+                    << std::setw(9) << scalarMs / ms << "x" << std::endl;
+                raster.clear();
+            }
+        }
+    std::cout << "  images " << (identical ? "identical" : "DIFFER") << " across kernels" << std::endl;
+}
+
+// runs the named benchmark; returns false if the name is unknown
+// ------------------------------------------------------------------------
+inline bool runBenchmark(const std::string& name, BenchContext& ctx)
+{
+    bool all = (name == "all");
+    bool found = false;
+    if (all || name == "instancing")
+    {
+        benchmarkInstancing(ctx);
+        found = true;
+    }
+    if (all || name == "trs")
+    {
+        benchmarkTRS(ctx);
+        found = true;
+    }
+    if (all || name == "drawlist")
+    {
+        benchmarkDrawList(ctx);
+        found = true;
+    }
+    if (all || name == "culling")
+    {
+        benchmarkCulling(ctx);
+        found = true;
+    }
+    if (all || name == "occlusion")
+    {
+        benchmarkOcclusion(ctx);
+        found = true;
+    }
+    if (all || name == "scene")
+    {
+        benchmarkScene(ctx);
+        found = true;
+    }
+    if (all || name == "imagediff")
+    {
+        benchmarkImageDiff(ctx);
+        found = true;
+    }
+    if (all || name == "softraster")
+    {
+        benchmarkSoftRaster(ctx);
+        found = true;
+    }
+    if (all || name == "rasterkernels")
+    {
+        benchmarkRasterKernels(ctx);
+        found = true;
+    }
+    if (!found)
+        std::cout << "Unknown benchmark: " << name << " (available: instancing, trs, drawlist, culling, occlusion, scene, imagediff, softraster, rasterkernels, all)" << std::endl;
+    return found;
+}
+
+#endif
@@ -0,0 +1,222 @@
+#pragma once
+//
+//  cube_renderer.h
+//  3D Object Drawing
+//
+//  Cube drawing paths: the original one-draw-per-cube drawCube() and an
+//  instanced renderer that submits a whole batch of cubes with one draw call.
+//
+
+#ifndef CUBE_RENDERER_H
+#define CUBE_RENDERER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "shader.h"
+#include "mesh_cache.h"
+#include "transform_math.h"
+#include "stream_buffer.h"
+#include "frustum.h"
+#include "occlusion.h"
+#include "profiler.h"
+
+#include <vector>
+#include <cstddef>
+
+// the cube mesh spans [0, 0.5]; every cube is drawn centered on its origin
+const glm::vec3 CUBE_PIVOT(-0.25f, -0.25f, -0.25f);
+
+// model matrix of a cube placed relative to parentTrans (rotation in degrees, cube centered on its origin)
+// ------------------------------------------------------------------------
+inline glm::mat4 cubeModelMatrix(const glm::mat4& parentTrans,
+    float posX, float posY, float posZ,
+    float rotX, float rotY, float rotZ,
+    float scX, float scY, float scZ)
+{
+    return composeTRS(parentTrans, glm::vec3(posX, posY, posZ), glm::vec3(rotX, rotY, rotZ), glm::vec3(scX, scY, scZ), CUBE_PIVOT);
+}
+
+// the original translate/rotate/rotate/rotate/scale/translate chain, kept as the reference for composeTRS
+// ------------------------------------------------------------------------
+inline glm::mat4 cubeModelMatrixChain(const glm::mat4& parentTrans,
+    float posX, float posY, float posZ,
+    float rotX, float rotY, float rotZ,
+    float scX, float scY, float scZ)
+{
+    // Apply transformations: translation, rotation, scaling
+    glm::mat4 translateMatrix, rotateXMatrix, rotateYMatrix, rotateZMatrix, model;
+    translateMatrix = glm::translate(parentTrans, glm::vec3(posX, posY, posZ));
+    rotateXMatrix = glm::rotate(translateMatrix, glm::radians(rotX), glm::vec3(1.0f, 0.0f, 0.0f));
+    rotateYMatrix = glm::rotate(rotateXMatrix, glm::radians(rotY), glm::vec3(0.0f, 1.0f, 0.0f));
+    rotateZMatrix = glm::rotate(rotateYMatrix, glm::radians(rotZ), glm::vec3(0.0f, 0.0f, 1.0f));
+    model = glm::scale(rotateZMatrix, glm::vec3(scX, scY, scZ));
+    return glm::translate(model, CUBE_PIVOT);
+}
+
+// Draw Cube Function: one program bind, two uniform uploads and one draw call per cube
+// ------------------------------------------------------------------------
+inline void drawCube(Shader& shaderProgram, unsigned int VAO, glm::mat4 parentTrans,
+    float posX = 0.0f, float posY = 0.0f, float posZ = 0.0f,
+    float rotX = 0.0f, float rotY = 0.0f, float rotZ = 0.0f,
+    float scX = 1.0f, float scY = 1.0f, float scZ = 1.0f,
+    glm::vec4 color = glm::vec4(0.0f, 0.0f, 0.0f, 0.0f))
+{
+    PROFILE_ZONE("drawCube");
+    shaderProgram.use();
+
+    // Set the model transformation in the shader
+    shaderProgram.setMat4("model", cubeModelMatrix(parentTrans, posX, posY, posZ, rotX, rotY, rotZ, scX, scY, scZ));
+
+    // Use the custom color passed to the function
+    shaderProgram.setVec4("color", color);
+
+    // Draw the cube
+    glState().bindVertexArray(VAO);
+    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
+}
+
+// per-instance attributes; layout must match instancedVertexShader.vs (locations 2-5 model, 6 color)
+struct CubeInstance
+{
+    glm::mat4 model;
+    glm::vec4 color;
+};
+
+// records a cube with the same arguments drawCube() takes
+// ------------------------------------------------------------------------
+inline void addCube(std::vector<CubeInstance>& instances, const glm::mat4& parentTrans,
+    float posX = 0.0f, float posY = 0.0f, float posZ = 0.0f,
+    float rotX = 0.0f, float rotY = 0.0f, float rotZ = 0.0f,
+    float scX = 1.0f, float scY = 1.0f, float scZ = 1.0f,
+    glm::vec4 color = glm::vec4(0.0f, 0.0f, 0.0f, 0.0f))
+{
+    CubeInstance instance;
+    instance.model = cubeModelMatrix(parentTrans, posX, posY, posZ, rotX, rotY, rotZ, scX, scY, scZ);
+    instance.color = color;
+    instances.push_back(instance);
+}
+
+class InstancedCubeRenderer
+{
+public:
+    unsigned int VAO = 0;
+    StreamBuffer instanceStream;
+    unsigned int indexCount = 0;
+    size_t drawCalls = 0;
+    CullStats culling;
+
+    // shares the cube mesh's vertex and index buffers; instances stream through a ring buffer
+    // ------------------------------------------------------------------------
+    void init(const Mesh& cube)
+    {
+        indexCount = cube.indexCount;
+        cubeBounds = cube.bounds;
+
+        glGenVertexArrays(1, &VAO);
+        instanceStream.init(1024 * sizeof(CubeInstance));
+
+        glState().bindVertexArray(VAO);
+
+        glState().bindBuffer(GL_ARRAY_BUFFER, cube.VBO);
+        glState().bindBuffer(GL_ELEMENT_ARRAY_BUFFER, cube.EBO);
+
+        // position attribute
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
+        glEnableVertexAttribArray(0);
+
+        // color attribute
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
+        glEnableVertexAttribArray(1);
+
+        // model matrix attribute (one column per location) and instance color, advanced once per
+        // instance; their pointers are set by upload() because the ring offset changes every frame
+        for (unsigned int i = 0; i < 5; i++)
+        {
+            glEnableVertexAttribArray(2 + i);
+            glVertexAttribDivisor(2 + i, 1);
+        }
+
+        glState().bindVertexArray(0);
+    }
+    // streams the instances and points the VAO at them; a draw list can then issue the
+    // instanced draw on VAO later in the same frame
+    // ------------------------------------------------------------------------
+    void upload(const CubeInstance* instances, size_t count)
+    {
+        PROFILE_ZONE("InstancedCubeRenderer::upload");
+        if (count == 0)
+            return;
+
+        size_t base = instanceStream.write(instances, count * sizeof(CubeInstance), sizeof(glm::vec4));
+
+        glState().bindVertexArray(VAO);
+        glState().bindBuffer(GL_ARRAY_BUFFER, instanceStream.buffer);
+        for (unsigned int i = 0; i < 4; i++)
+            glVertexAttribPointer(2 + i, 4, GL_FLOAT, GL_FALSE, sizeof(CubeInstance), (void*)(base + offsetof(CubeInstance, model) + i * sizeof(glm::vec4)));
+        glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(CubeInstance), (void*)(base + offsetof(CubeInstance, color)));
+    }
+    void upload(const std::vector<CubeInstance>& instances)
+    {
+        upload(instances.data(), instances.size());
+    }
+    // uploads the instances and draws all of them with one call; the shader must already be in use
+    // ------------------------------------------------------------------------
+    void draw(const CubeInstance* instances, size_t count)
+    {
+        if (count == 0)
+            return;
+
+        upload(instances, count);
+        glState().bindVertexArray(VAO);
+        glDrawElementsInstanced(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, 0, (GLsizei)count);
+        drawCalls++;
+    }
+    void draw(const std::vector<CubeInstance>& instances)
+    {
+        draw(instances.data(), instances.size());
+    }
+    // removes the instances whose world bounds lie outside the frustum, keeping their order
+    // ------------------------------------------------------------------------
+    size_t cull(const Frustum& frustum, std::vector<CubeInstance>& instances)
+    {
+        size_t count = instances.size();
+        boxes.resize(count);
+        for (size_t i = 0; i < count; i++)
+            boxes.set(i, transformAABB(cubeBounds, instances[i].model));
+        size_t kept = cullAABBs(frustum, boxes, count, visible);
+        for (size_t i = 0; i < kept; i++)
+            instances[i] = instances[visible[i]];
+        instances.resize(kept);
+        culling.record(count, kept);
+        return kept;
+    }
+    // removes the instances hidden behind the occluders, keeping their order
+    // ------------------------------------------------------------------------
+    size_t cullOccluded(OcclusionBuffer& occlusion, std::vector<CubeInstance>& instances)
+    {
+        const AABB& bounds = cubeBounds;
+        return occlusion.removeOccluded(instances, [&bounds](const CubeInstance& instance) { return transformAABB(bounds, instance.model); });
+    }
+    // call once per frame after the last draw that reads this frame's instances
+    // ------------------------------------------------------------------------
+    void endFrame()
+    {
+        instanceStream.endFrame();
+    }
+    // ------------------------------------------------------------------------
+    void clear()
+    {
+        glState().deleteVertexArray(VAO);
+        instanceStream.clear();
+        VAO = 0;
+    }
+
+private:
+    AABB cubeBounds;
+    AABBArrays boxes;
+    std::vector<unsigned int> visible;
+};
+
+#endif
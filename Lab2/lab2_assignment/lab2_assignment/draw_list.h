@@ -0,0 +1,313 @@
+#pragma once
+//
+//  draw_list.h
+//  3D Object Drawing
+//
+//  Per-frame list of draw commands. Each command carries a 64-bit sort key
+//  (pass, program, mesh, material, depth bucket); the list is radix-sorted
+//  before submission so program/VAO/material changes are grouped and opaque
+//  geometry reaches the GPU front to back.
+//
+
+#ifndef DRAW_LIST_H
+#define DRAW_LIST_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "shader.h"
+#include "gl_state_cache.h"
+#include "frustum.h"
+#include "occlusion.h"
+#include "gpu_timer.h"
+#include "profiler.h"
+
+#include <vector>
+#include <utility>
+#include <iostream>
+#include <cstddef>
+#include <cstdint>
+
+enum RenderPass
+{
+    PASS_OPAQUE = 0,
+    PASS_TRANSPARENT = 1,
+    PASS_OVERLAY = 2
+};
+
+// key layout, most significant first
+//   opaque/overlay: pass:4 | program:8 | mesh:12 | material:16 | depth:24 (near first)
+//   transparent:    pass:4 | depth:24 (far first) | program:8 | mesh:12 | material:16
+// program and mesh are the GL names truncated to their field; a collision only costs sort quality
+// ------------------------------------------------------------------------
+inline uint64_t makeSortKey(RenderPass pass, unsigned int program, unsigned int mesh, unsigned int material, unsigned int depth)
+{
+    uint64_t key = (uint64_t)(pass & 0xF) << 60;
+    uint64_t programBits = program & 0xFF;
+    uint64_t meshBits = mesh & 0xFFF;
+    uint64_t materialBits = material & 0xFFFF;
+    uint64_t depthBits = depth & 0xFFFFFF;
+    if (pass == PASS_TRANSPARENT)
+        return key | ((0xFFFFFF - depthBits) << 36) | (programBits << 28) | (meshBits << 16) | materialBits;
+    return key | (programBits << 52) | (meshBits << 40) | (materialBits << 24) | depthBits;
+}
+
+// quantizes a view-space distance into the 24-bit depth field
+// ------------------------------------------------------------------------
+inline unsigned int depthBucket(float viewDepth, float nearPlane, float farPlane)
+{
+    float t = (viewDepth - nearPlane) / (farPlane - nearPlane);
+    if (!(t > 0.0f))
+        return 0;
+    if (t >= 1.0f)
+        return 0xFFFFFF;
+    return (unsigned int)(t * 16777215.0f);
+}
+
+struct SortEntry
+{
+    uint64_t key;
+    unsigned int index;
+};
+
+// stable LSD radix sort on the full 64-bit key, one byte per pass; bytes that are the
+// same in every key are skipped, so a frame with few programs and meshes sorts in 3-4 passes
+// ------------------------------------------------------------------------
+inline void radixSort(std::vector<SortEntry>& entries, std::vector<SortEntry>& scratch)
+{
+    size_t count = entries.size();
+    if (count < 2)
+        return;
+    scratch.resize(count);
+
+    size_t histogram[8][256] = {};
+    for (size_t i = 0; i < count; i++)
+    {
+        uint64_t key = entries[i].key;
+        for (int b = 0; b < 8; b++)
+            histogram[b][(key >> (b * 8)) & 0xFF]++;
+    }
+
+    SortEntry* src = entries.data();
+    SortEntry* dst = scratch.data();
+    for (int b = 0; b < 8; b++)
+    {
+        size_t* counts = histogram[b];
+        if (counts[(src[0].key >> (b * 8)) & 0xFF] == count)
+            continue;
+
+        size_t offset = 0;
+        for (int d = 0; d < 256; d++)
+        {
+            size_t n = counts[d];
+            counts[d] = offset;
+            offset += n;
+        }
+        for (size_t i = 0; i < count; i++)
+            dst[counts[(src[i].key >> (b * 8)) & 0xFF]++] = src[i];
+        std::swap(src, dst);
+    }
+    if (src != entries.data())
+        entries.swap(scratch);
+}
+
+// one recorded draw; model and color are uploaded only when their handles are valid
+struct DrawCommand
+{
+    const Shader* shader;
+    unsigned int VAO;
+    GLenum mode;
+    GLsizei count;              // indices (indexed) or vertices
+    bool indexed;
+    GLsizei instanceCount;      // 0 for a plain draw
+    UniformMat4 modelUniform;
+    glm::mat4 model;
+    UniformVec4 colorUniform;
+    glm::vec4 color;
+    AABB bounds;                // world space, tested by DrawList::cull()
+    GpuScope gpuScope;          // GPU time of the draw is added to this scope, if any
+};
+
+// a command with no per-draw uniforms and unbounded extent; set modelUniform/colorUniform/bounds afterwards as needed
+// ------------------------------------------------------------------------
+inline DrawCommand makeDrawCommand(const Shader& shader, unsigned int VAO, GLenum mode, GLsizei count,
+    bool indexed, GLsizei instanceCount = 0)
+{
+    DrawCommand command;
+    command.shader = &shader;
+    command.VAO = VAO;
+    command.mode = mode;
+    command.count = count;
+    command.indexed = indexed;
+    command.instanceCount = instanceCount;
+    command.model = glm::mat4(1.0f);
+    command.color = glm::vec4(0.0f);
+    command.bounds = infiniteAABB();
+    command.gpuScope = NO_GPU_SCOPE;
+    return command;
+}
+
+// distance in front of the camera of a world-space point
+// ------------------------------------------------------------------------
+inline float viewDepth(const glm::mat4& view, const glm::vec3& position)
+{
+    return -(view * glm::vec4(position, 1.0f)).z;
+}
+
+class DrawList
+{
+public:
+    // counters of the last submit()
+    size_t submitted = 0;
+    size_t programSwitches = 0;
+    size_t vertexArraySwitches = 0;
+    size_t materialChanges = 0;
+    size_t triangles = 0;
+    CullStats culling;
+
+    // submit() brackets runs of draws that share a gpuScope with timer queries
+    // ------------------------------------------------------------------------
+    void setGpuTimer(GpuTimer* timer)
+    {
+        gpuTimer = timer;
+    }
+    // distances are bucketed over [nearPlane, farPlane]
+    // ------------------------------------------------------------------------
+    void setDepthRange(float nearPlane, float farPlane)
+    {
+        depthNear = nearPlane;
+        depthFar = farPlane;
+    }
+    // ------------------------------------------------------------------------
+    void clear()
+    {
+        commands.clear();
+        entries.clear();
+    }
+    // records a draw; material groups draws that share uniform values, viewDepth is the
+    // distance of the object from the camera
+    // ------------------------------------------------------------------------
+    void add(RenderPass pass, unsigned int material, float viewDepth, const DrawCommand& command)
+    {
+        SortEntry entry;
+        entry.key = makeSortKey(pass, command.shader->ID, command.VAO, material, depthBucket(viewDepth, depthNear, depthFar));
+        entry.index = (unsigned int)commands.size();
+        entries.push_back(entry);
+        commands.push_back(command);
+    }
+    // drops the draws whose bounds lie outside the frustum; call before sort()
+    // ------------------------------------------------------------------------
+    void cull(const Frustum& frustum)
+    {
+        size_t count = entries.size();
+        boxes.resize(count);
+        for (size_t i = 0; i < count; i++)
+            boxes.set(i, commands[entries[i].index].bounds);
+        size_t kept = cullAABBs(frustum, boxes, count, visible);
+        for (size_t i = 0; i < kept; i++)
+            entries[i] = entries[visible[i]];
+        entries.resize(kept);
+        culling.record(count, kept);
+    }
+    // drops the draws hidden behind the occluders; call after cull(frustum)
+    // ------------------------------------------------------------------------
+    void cullOccluded(OcclusionBuffer& occlusion)
+    {
+        occlusion.removeOccluded(entries, [this](const SortEntry& entry) { return commands[entry.index].bounds; });
+    }
+    // ------------------------------------------------------------------------
+    void sort()
+    {
+        PROFILE_ZONE("DrawList::sort");
+        radixSort(entries, scratch);
+    }
+    // issues every command in key order (call sort() first, or not, to submit in record order)
+    // ------------------------------------------------------------------------
+    void submit()
+    {
+        PROFILE_ZONE("DrawList::submit");
+        submitted = programSwitches = vertexArraySwitches = materialChanges = triangles = 0;
+        const Shader* lastShader = NULL;
+        unsigned int lastVAO = 0xFFFFFFFFu;
+        uint64_t lastMaterial = ~(uint64_t)0;
+        GpuScope lastScope = NO_GPU_SCOPE;
+        for (size_t i = 0; i < entries.size(); i++)
+        {
+            const DrawCommand& cmd = commands[entries[i].index];
+            uint64_t material = materialBits(entries[i].key);
+            if (gpuTimer && cmd.gpuScope != lastScope)
+            {
+                gpuTimer->end(lastScope);
+                gpuTimer->begin(cmd.gpuScope);
+                lastScope = cmd.gpuScope;
+            }
+            if (cmd.shader != lastShader)
+            {
+                cmd.shader->use();
+                lastShader = cmd.shader;
+                lastMaterial = ~(uint64_t)0;
+                programSwitches++;
+            }
+            if (cmd.colorUniform.valid() && material != lastMaterial)
+            {
+                cmd.shader->set(cmd.colorUniform, cmd.color);
+                lastMaterial = material;
+                materialChanges++;
+            }
+            if (cmd.modelUniform.valid())
+                cmd.shader->set(cmd.modelUniform, cmd.model);
+            if (cmd.VAO != lastVAO)
+            {
+                glState().bindVertexArray(cmd.VAO);
+                lastVAO = cmd.VAO;
+                vertexArraySwitches++;
+            }
+
+            if (cmd.indexed && cmd.instanceCount > 0)
+                glDrawElementsInstanced(cmd.mode, cmd.count, GL_UNSIGNED_INT, 0, cmd.instanceCount);
+            else if (cmd.indexed)
+                glDrawElements(cmd.mode, cmd.count, GL_UNSIGNED_INT, 0);
+            else if (cmd.instanceCount > 0)
+                glDrawArraysInstanced(cmd.mode, 0, cmd.count, cmd.instanceCount);
+            else
+                glDrawArrays(cmd.mode, 0, cmd.count);
+            submitted++;
+            if (cmd.mode == GL_TRIANGLES)
+                triangles += (size_t)(cmd.count / 3) * (cmd.instanceCount > 0 ? cmd.instanceCount : 1);
+        }
+        if (gpuTimer)
+            gpuTimer->end(lastScope);
+    }
+    // ------------------------------------------------------------------------
+    size_t size() const
+    {
+        return commands.size();
+    }
+    // ------------------------------------------------------------------------
+    void printStats() const
+    {
+        std::cout << "DrawList: " << submitted << " draws, " << programSwitches << " program switches, "
+            << vertexArraySwitches << " VAO switches, " << materialChanges << " material changes, " << triangles << " triangles" << std::endl;
+        culling.printStats("DrawList culling");
+    }
+
+private:
+    std::vector<DrawCommand> commands;
+    std::vector<SortEntry> entries;
+    std::vector<SortEntry> scratch;
+    AABBArrays boxes;
+    std::vector<unsigned int> visible;
+    float depthNear = 0.1f;
+    float depthFar = 100.0f;
+    GpuTimer* gpuTimer = NULL;
+
+    // the material field of either key layout
+    static uint64_t materialBits(uint64_t key)
+    {
+        if ((key >> 60) == PASS_TRANSPARENT)
+            return key & 0xFFFF;
+        return (key >> 24) & 0xFFFF;
+    }
+};
+
+#endif
@@ -0,0 +1,89 @@
+#pragma once
+//
+//  fixed_timestep.h
+//  3D Object Drawing
+//
+//  Accumulator for running the simulation at a fixed rate independent of the
+//  render rate. Each frame adds its elapsed time, runs as many whole steps as
+//  fit, and renders state interpolated by alpha() between the last two steps.
+//
+
+#ifndef FIXED_TIMESTEP_H
+#define FIXED_TIMESTEP_H
+
+#include <iostream>
+#include <cstddef>
+
+// simulation rate used when the command line does not set one
+const double DEFAULT_SIMULATION_HZ = 120.0;
+
+class FixedTimestep
+{
+public:
+    double step = 1.0 / DEFAULT_SIMULATION_HZ;
+    // a long stall (debugger, window drag) runs at most this many steps, the rest is dropped
+    int maxStepsPerFrame = 8;
+    size_t frames = 0;
+    size_t steps = 0;
+    double droppedSeconds = 0.0;
+
+    // ------------------------------------------------------------------------
+    void init(double stepsPerSecond)
+    {
+        step = 1.0 / (stepsPerSecond > 0.0 ? stepsPerSecond : DEFAULT_SIMULATION_HZ);
+        accumulator = 0.0;
+    }
+    // adds one frame's elapsed time; returns how many simulation steps to run now
+    // ------------------------------------------------------------------------
+    int advance(double frameSeconds)
+    {
+        frames++;
+        if (frameSeconds > 0.0)
+            accumulator += frameSeconds;
+        int count = (int)(accumulator / step);
+        if (count > maxStepsPerFrame)
+        {
+            double excess = (count - maxStepsPerFrame) * step;
+            droppedSeconds += excess;
+            accumulator -= excess;
+            count = maxStepsPerFrame;
+        }
+        accumulator -= count * step;
+        steps += count;
+        return count;
+    }
+    // fraction of a step left in the accumulator: 0 renders the previous step, 1 the latest
+    // ------------------------------------------------------------------------
+    float alpha() const
+    {
+        return (float)(accumulator / step);
+    }
+    float stepSeconds() const
+    {
+        return (float)step;
+    }
+    // ------------------------------------------------------------------------
+    void printStats() const
+    {
+        size_t n = frames > 0 ? frames : 1;
+        std::cout << "FixedTimestep: " << 1.0 / step << " Hz, " << steps << " steps over " << frames << " frames ("
+            << (double)steps / n << " per frame), " << droppedSeconds << " s dropped" << std::endl;
+    }
+
+private:
+    double accumulator = 0.0;
+};
+
+// linear blend of two angles in degrees along the shorter way round
+// ------------------------------------------------------------------------
+inline float lerpAngle(float from, float to, float alpha)
+{
+    float delta = to - from;
+    while (delta > 180.0f)
+        delta -= 360.0f;
+    while (delta < -180.0f)
+        delta += 360.0f;
+    return from + delta * alpha;
+}
+
+#endif
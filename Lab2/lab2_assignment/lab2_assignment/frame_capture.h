@@ -0,0 +1,258 @@
+#pragma once
+//
+//  frame_capture.h
+//  3D Object Drawing
+//
+//  Frame dumps that do not stall the render loop. capture() starts an
+//  asynchronous glReadPixels of the bound read framebuffer (back buffer or
+//  FBO) into one of CAPTURE_FRAMES pixel pack buffers and fences it. The
+//  buffer is mapped when capture() comes back to that slot, CAPTURE_FRAMES
+//  frames later and long after the copy is done, and its rows are copied
+//  top-down into an Image that a worker pool encodes to PPM/PNG files or
+//  converts to YUV and appends, in frame order, to a Y4M stream. Time spent
+//  on the render thread is measured per frame.
+//
+
+#ifndef FRAME_CAPTURE_H
+#define FRAME_CAPTURE_H
+
+#include <glad/glad.h>
+
+#include "gl_state_cache.h"
+#include "image_io.h"
+#include "worker_pool.h"
+#include "profiler.h"
+
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <memory>
+#include <chrono>
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+#include <cstddef>
+
+// pixel pack buffers in the ring; a slot is mapped this many frames after its glReadPixels
+const int CAPTURE_FRAMES = 3;
+// images waiting for the workers before new frames are dropped instead of queued
+const size_t CAPTURE_MAX_BACKLOG = 16;
+
+enum CaptureFormat
+{
+    CAPTURE_PPM,
+    CAPTURE_PNG,
+    CAPTURE_Y4M
+};
+
+// "ppm", "png" or "y4m"
+// ------------------------------------------------------------------------
+inline bool parseCaptureFormat(const std::string& name, CaptureFormat& format)
+{
+    if (name == "ppm")
+        format = CAPTURE_PPM;
+    else if (name == "png")
+        format = CAPTURE_PNG;
+    else if (name == "y4m")
+        format = CAPTURE_Y4M;
+    else
+    {
+        std::cout << "ERROR::FRAME_CAPTURE::UNKNOWN_FORMAT " << name << " (expected ppm, png or y4m)" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+class FrameCapture
+{
+public:
+    int width = 0, height = 0;
+    size_t captured = 0;        // reads started
+    size_t encoded = 0;         // images handed to the workers
+    size_t dropped = 0;         // frames skipped because the workers were behind
+    size_t stalls = 0;          // maps whose fence had not signaled yet
+    double renderThreadMs = 0.0;
+
+    // output is a file name prefix for images ("captures/frame" -> captures/frame_000001.png) and the file for y4m
+    // ------------------------------------------------------------------------
+    bool init(int captureWidth, int captureHeight, CaptureFormat captureFormat, const std::string& captureOutput,
+        int fps = 60, unsigned int workerCount = 0)
+    {
+        width = captureWidth;
+        height = captureHeight;
+        format = captureFormat;
+        output = captureOutput;
+        if (format == CAPTURE_Y4M)
+        {
+            if ((width | height) & 1)
+            {
+                std::cout << "ERROR::FRAME_CAPTURE::ODD_SIZE y4m needs an even width and height" << std::endl;
+                return false;
+            }
+            if (!video.open(output, width, height, fps))
+                return false;
+        }
+
+        size_t bytes = (size_t)width * height * 4;
+        for (int i = 0; i < CAPTURE_FRAMES; i++)
+        {
+            glGenBuffers(1, &slots[i].buffer);
+            glState().bindBuffer(GL_PIXEL_PACK_BUFFER, slots[i].buffer);
+            glBufferData(GL_PIXEL_PACK_BUFFER, bytes, NULL, GL_STREAM_READ);
+            slots[i].fence = 0;
+        }
+        glState().bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        workers.start(workerCount);
+        return true;
+    }
+    // starts reading the current frame; call once rendering is done and before the swap
+    // ------------------------------------------------------------------------
+    void capture()
+    {
+        PROFILE_ZONE("FrameCapture::capture");
+        Clock::time_point start = Clock::now();
+        Slot& slot = slots[next];
+        if (slot.fence)
+            collect(slot);
+
+        glState().bindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+        glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+        glState().bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        slot.frame = captured++;
+        next = (next + 1) % CAPTURE_FRAMES;
+        renderThreadMs += std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+    // collects the frames still in flight and waits for every encode
+    // ------------------------------------------------------------------------
+    void finish()
+    {
+        for (int i = 0; i < CAPTURE_FRAMES; i++)
+        {
+            Slot& slot = slots[(next + i) % CAPTURE_FRAMES];
+            if (slot.fence)
+                collect(slot);
+        }
+        workers.wait();
+        video.close();
+    }
+    // ------------------------------------------------------------------------
+    void printStats(double loopSeconds) const
+    {
+        size_t n = captured > 0 ? captured : 1;
+        std::cout << "FrameCapture: " << captured << " frames read, " << encoded << " encoded, " << dropped << " dropped, "
+            << stalls << " stalls; " << renderThreadMs / n << " ms per frame on the render thread ("
+            << (loopSeconds > 0.0 ? 100.0 * renderThreadMs / (1000.0 * loopSeconds) : 0.0) << "% of the run)" << std::endl;
+    }
+    // ------------------------------------------------------------------------
+    void clear()
+    {
+        workers.stop();
+        for (int i = 0; i < CAPTURE_FRAMES; i++)
+        {
+            if (slots[i].fence)
+                glDeleteSync(slots[i].fence);
+            if (slots[i].buffer)
+                glState().deleteBuffer(slots[i].buffer);
+            slots[i].fence = 0;
+            slots[i].buffer = 0;
+        }
+    }
+
+private:
+    typedef std::chrono::high_resolution_clock Clock;
+
+    struct Slot
+    {
+        unsigned int buffer = 0;
+        GLsync fence = 0;
+        size_t frame = 0;
+    };
+
+    CaptureFormat format = CAPTURE_PNG;
+    std::string output;
+    Slot slots[CAPTURE_FRAMES];
+    int next = 0;
+    WorkerPool workers;
+
+    // y4m frames are appended in order whichever worker finishes first
+    Y4MWriter video;
+    std::mutex videoMutex;
+    std::map<size_t, std::vector<uint8_t>> videoPending;
+    size_t videoNext = 0;
+
+    // maps a finished read and hands a top-down copy to the workers
+    void collect(Slot& slot)
+    {
+        GLenum status = glClientWaitSync(slot.fence, 0, 0);
+        if (status == GL_TIMEOUT_EXPIRED)
+        {
+            stalls++;
+            glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ull);
+        }
+        glDeleteSync(slot.fence);
+        slot.fence = 0;
+
+        // y4m frames are never dropped: the video would lose its timing
+        bool behind = workers.pending() >= CAPTURE_MAX_BACKLOG;
+        if (behind && format != CAPTURE_Y4M)
+        {
+            dropped++;
+            return;
+        }
+
+        std::shared_ptr<Image> image(new Image());
+        image->resize(width, height);
+        glState().bindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+        const uint8_t* pixels = (const uint8_t*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (size_t)width * height * 4, GL_MAP_READ_BIT);
+        if (pixels)
+        {
+            size_t rowBytes = (size_t)width * 4;
+            for (int y = 0; y < height; y++)
+                std::memcpy(image->row(y), pixels + rowBytes * (height - 1 - y), rowBytes);
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        }
+        glState().bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        if (!pixels)
+        {
+            std::cout << "ERROR::FRAME_CAPTURE::MAP_FAILED frame " << slot.frame << std::endl;
+            image->rgba.assign(image->rgba.size(), 0);
+        }
+
+        size_t frame = slot.frame;
+        encoded++;
+        workers.submit([this, image, frame]() { encode(*image, frame); });
+    }
+
+    void encode(const Image& image, size_t frame)
+    {
+        PROFILE_ZONE("FrameCapture::encode");
+        if (format == CAPTURE_Y4M)
+        {
+            std::vector<uint8_t> i420(Y4MWriter::frameBytes(width, height));
+            size_t lumaBytes = (size_t)width * height;
+            rgbaToI420(image, &i420[0], &i420[lumaBytes], &i420[lumaBytes + lumaBytes / 4]);
+
+            std::lock_guard<std::mutex> lock(videoMutex);
+            videoPending[frame].swap(i420);
+            for (auto ready = videoPending.find(videoNext); ready != videoPending.end(); ready = videoPending.find(videoNext))
+            {
+                video.append(ready->second);
+                videoPending.erase(ready);
+                videoNext++;
+            }
+            return;
+        }
+
+        char suffix[32];
+        std::snprintf(suffix, sizeof(suffix), "_%06u.%s", (unsigned int)frame, format == CAPTURE_PNG ? "png" : "ppm");
+        if (format == CAPTURE_PNG)
+            writePNG(output + suffix, image);
+        else
+            writePPM(output + suffix, image);
+    }
+};
+
+#endif
@@ -0,0 +1,110 @@
+#pragma once
+//
+//  frame_uniforms.h
+//  3D Object Drawing
+//
+//  Per-frame camera data shared by every program through one std140 uniform
+//  buffer, so view/projection are uploaded once per frame instead of per program.
+//
+
+#ifndef FRAME_UNIFORMS_H
+#define FRAME_UNIFORMS_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "gl_state_cache.h"
+#include "profiler.h"
+
+#include <cstring>
+#include <cstddef>
+
+// binding point of the FrameData block in every shader
+const GLuint FRAME_UNIFORMS_BINDING = 0;
+
+// mirrors "layout (std140) uniform FrameData" in the vertex shaders
+struct FrameData
+{
+    glm::mat4 view;             // offset   0
+    glm::mat4 projection;       // offset  64
+    glm::mat4 viewProjection;   // offset 128
+    glm::vec4 cameraPosition;   // offset 192, w unused
+    float time;                 // offset 208
+    float padding[3];           // block size is rounded up to 16 bytes
+};
+static_assert(sizeof(FrameData) == 224, "FrameData must match the std140 layout of the FrameData block");
+
+class FrameUniformBuffer
+{
+public:
+    unsigned int UBO = 0;
+    size_t bytesUploaded = 0;   // total bytes sent with glBufferSubData since init()
+    size_t uploads = 0;         // number of glBufferSubData calls since init()
+
+    // ------------------------------------------------------------------------
+    void init()
+    {
+        std::memset(&current, 0, sizeof(current));
+        glGenBuffers(1, &UBO);
+        glState().bindBuffer(GL_UNIFORM_BUFFER, UBO);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameData), &current, GL_DYNAMIC_DRAW);
+        // also leaves the generic binding on UBO, which is what the cache recorded
+        glBindBufferBase(GL_UNIFORM_BUFFER, FRAME_UNIFORMS_BINDING, UBO);
+    }
+    // writes this frame's values, uploading only the 16-byte rows that changed
+    // ------------------------------------------------------------------------
+    void update(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& cameraPosition, float time)
+    {
+        PROFILE_ZONE("FrameUniformBuffer::update");
+        FrameData next;
+        std::memset(&next, 0, sizeof(next));
+        next.view = view;
+        next.projection = projection;
+        next.viewProjection = projection * view;
+        next.cameraPosition = glm::vec4(cameraPosition, 1.0f);
+        next.time = time;
+
+        const unsigned char* oldBytes = reinterpret_cast<const unsigned char*>(&current);
+        const unsigned char* newBytes = reinterpret_cast<const unsigned char*>(&next);
+        const size_t rowSize = 16;
+        const size_t rows = sizeof(FrameData) / rowSize;
+
+        size_t row = 0;
+        while (row < rows)
+        {
+            if (std::memcmp(oldBytes + row * rowSize, newBytes + row * rowSize, rowSize) == 0)
+            {
+                row++;
+                continue;
+            }
+            // coalesce consecutive dirty rows into one upload
+            size_t first = row;
+            while (row < rows && std::memcmp(oldBytes + row * rowSize, newBytes + row * rowSize, rowSize) != 0)
+                row++;
+
+            glState().bindBuffer(GL_UNIFORM_BUFFER, UBO);
+            size_t offset = first * rowSize;
+            size_t size = (row - first) * rowSize;
+            glBufferSubData(GL_UNIFORM_BUFFER, offset, size, newBytes + offset);
+            bytesUploaded += size;
+            uploads++;
+        }
+        current = next;
+    }
+    // ------------------------------------------------------------------------
+    const FrameData& data() const
+    {
+        return current;
+    }
+    // ------------------------------------------------------------------------
+    void clear()
+    {
+        glState().deleteBuffer(UBO);
+        UBO = 0;
+    }
+
+private:
+    FrameData current;
+};
+
+#endif
@@ -0,0 +1,213 @@
+#pragma once
+//
+//  frustum.h
+//  3D Object Drawing
+//
+//  View frustum planes, axis-aligned bounding boxes and the culling pass that
+//  tests boxes against the six planes. Boxes are kept as center/extent in
+//  structure-of-arrays form so the SSE2 path tests four boxes per iteration.
+//
+
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include <glm/glm.hpp>
+
+#include "transform_math.h"
+
+#include <vector>
+#include <iostream>
+#include <cmath>
+#include <cstddef>
+
+struct AABB
+{
+    glm::vec3 min;
+    glm::vec3 max;
+};
+
+// a box that passes every plane; used for draws that have no meaningful bounds
+// ------------------------------------------------------------------------
+inline AABB infiniteAABB()
+{
+    AABB box = { glm::vec3(-1.0e30f), glm::vec3(1.0e30f) };
+    return box;
+}
+
+// an inverted box that any point grows into
+// ------------------------------------------------------------------------
+inline AABB emptyAABB()
+{
+    AABB box = { glm::vec3(1.0e30f), glm::vec3(-1.0e30f) };
+    return box;
+}
+
+// ------------------------------------------------------------------------
+inline void growAABB(AABB& box, const glm::vec3& point)
+{
+    box.min = glm::min(box.min, point);
+    box.max = glm::max(box.max, point);
+}
+
+// world box of a local box under an affine transform (Arvo's method: extent through |M|)
+// ------------------------------------------------------------------------
+inline AABB transformAABB(const AABB& local, const glm::mat4& m)
+{
+    glm::vec3 center = (local.min + local.max) * 0.5f;
+    glm::vec3 extent = (local.max - local.min) * 0.5f;
+    glm::vec3 worldCenter = glm::vec3(m * glm::vec4(center, 1.0f));
+    glm::vec3 worldExtent = glm::abs(glm::vec3(m[0])) * extent.x + glm::abs(glm::vec3(m[1])) * extent.y + glm::abs(glm::vec3(m[2])) * extent.z;
+    AABB box = { worldCenter - worldExtent, worldCenter + worldExtent };
+    return box;
+}
+
+// six planes (a, b, c, d) with normals pointing inside: left, right, bottom, top, near, far
+struct Frustum
+{
+    glm::vec4 planes[6];
+};
+
+// Gribb/Hartmann extraction from a combined projection * view matrix
+// ------------------------------------------------------------------------
+inline Frustum extractFrustum(const glm::mat4& viewProjection)
+{
+    glm::vec4 row[4];
+    for (int i = 0; i < 4; i++)
+        row[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+
+    Frustum frustum;
+    frustum.planes[0] = row[3] + row[0];
+    frustum.planes[1] = row[3] - row[0];
+    frustum.planes[2] = row[3] + row[1];
+    frustum.planes[3] = row[3] - row[1];
+    frustum.planes[4] = row[3] + row[2];
+    frustum.planes[5] = row[3] - row[2];
+    for (int p = 0; p < 6; p++)
+        frustum.planes[p] /= glm::length(glm::vec3(frustum.planes[p]));
+    return frustum;
+}
+
+// ------------------------------------------------------------------------
+inline bool isVisible(const Frustum& frustum, const AABB& box)
+{
+    glm::vec3 center = (box.min + box.max) * 0.5f;
+    glm::vec3 extent = (box.max - box.min) * 0.5f;
+    for (int p = 0; p < 6; p++)
+    {
+        const glm::vec4& plane = frustum.planes[p];
+        float distance = glm::dot(glm::vec3(plane), center) + plane.w;
+        float radius = glm::dot(glm::abs(glm::vec3(plane)), extent);
+        if (distance + radius < 0.0f)
+            return false;
+    }
+    return true;
+}
+
+// boxes as center/extent columns
+struct AABBArrays
+{
+    std::vector<float> centerX, centerY, centerZ;
+    std::vector<float> extentX, extentY, extentZ;
+
+    void resize(size_t count)
+    {
+        centerX.resize(count); centerY.resize(count); centerZ.resize(count);
+        extentX.resize(count); extentY.resize(count); extentZ.resize(count);
+    }
+    void set(size_t i, const AABB& box)
+    {
+        centerX[i] = (box.min.x + box.max.x) * 0.5f;
+        centerY[i] = (box.min.y + box.max.y) * 0.5f;
+        centerZ[i] = (box.min.z + box.max.z) * 0.5f;
+        extentX[i] = (box.max.x - box.min.x) * 0.5f;
+        extentY[i] = (box.max.y - box.min.y) * 0.5f;
+        extentZ[i] = (box.max.z - box.min.z) * 0.5f;
+    }
+    size_t size() const
+    {
+        return centerX.size();
+    }
+};
+
+// writes the indices of the boxes that touch the frustum to visible (resized to count) and
+// returns how many there are; the SSE2 path tests four boxes against each plane at once
+// ------------------------------------------------------------------------
+inline size_t cullAABBs(const Frustum& frustum, const AABBArrays& boxes, size_t count, std::vector<unsigned int>& visible)
+{
+    visible.resize(count);
+    size_t n = 0;
+    size_t i = 0;
+#ifdef TRANSFORM_MATH_SSE2
+    __m128 plane[6][4], absNormal[6][3];
+    const __m128 signMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+    for (int p = 0; p < 6; p++)
+    {
+        for (int k = 0; k < 4; k++)
+            plane[p][k] = _mm_set1_ps(frustum.planes[p][k]);
+        for (int k = 0; k < 3; k++)
+            absNormal[p][k] = _mm_and_ps(plane[p][k], signMask);
+    }
+
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128 cx = _mm_loadu_ps(&boxes.centerX[i]), cy = _mm_loadu_ps(&boxes.centerY[i]), cz = _mm_loadu_ps(&boxes.centerZ[i]);
+        __m128 ex = _mm_loadu_ps(&boxes.extentX[i]), ey = _mm_loadu_ps(&boxes.extentY[i]), ez = _mm_loadu_ps(&boxes.extentZ[i]);
+
+        __m128 outside = _mm_setzero_ps();
+        for (int p = 0; p < 6; p++)
+        {
+            __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(plane[p][0], cx), _mm_mul_ps(plane[p][1], cy)),
+                _mm_add_ps(_mm_mul_ps(plane[p][2], cz), plane[p][3]));
+            __m128 radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(absNormal[p][0], ex), _mm_mul_ps(absNormal[p][1], ey)), _mm_mul_ps(absNormal[p][2], ez));
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(distance, radius), _mm_setzero_ps()));
+        }
+
+        int mask = _mm_movemask_ps(outside);
+        for (int k = 0; k < 4; k++)
+            if (!(mask & (1 << k)))
+                visible[n++] = (unsigned int)(i + k);
+    }
+#endif
+    for (; i < count; i++)
+    {
+        bool inside = true;
+        for (int p = 0; p < 6 && inside; p++)
+        {
+            const glm::vec4& plane = frustum.planes[p];
+            float distance = plane.x * boxes.centerX[i] + plane.y * boxes.centerY[i] + plane.z * boxes.centerZ[i] + plane.w;
+            float radius = std::fabs(plane.x) * boxes.extentX[i] + std::fabs(plane.y) * boxes.extentY[i] + std::fabs(plane.z) * boxes.extentZ[i];
+            inside = distance + radius >= 0.0f;
+        }
+        if (inside)
+            visible[n++] = (unsigned int)i;
+    }
+    visible.resize(n);
+    return n;
+}
+
+// visible vs. tested counts accumulated over frames
+struct CullStats
+{
+    size_t tested = 0;
+    size_t visible = 0;
+    size_t frames = 0;
+    size_t lastTested = 0;
+    size_t lastVisible = 0;
+
+    void record(size_t frameTested, size_t frameVisible)
+    {
+        lastTested = frameTested;
+        lastVisible = frameVisible;
+        tested += frameTested;
+        visible += frameVisible;
+        frames++;
+    }
+    void printStats(const char* label) const
+    {
+        size_t n = frames > 0 ? frames : 1;
+        std::cout << label << ": " << visible / n << " of " << tested / n << " visible per frame (last frame "
+            << lastVisible << " of " << lastTested << ")" << std::endl;
+    }
+};
+
+#endif
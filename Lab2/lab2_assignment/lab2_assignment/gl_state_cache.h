@@ -0,0 +1,273 @@
+#pragma once
+//
+//  gl_state_cache.h
+//  3D Object Drawing
+//
+//  Thin state-tracking layer over the glad entry points: program, VAO, buffer
+//  bindings, depth/blend/cull state and polygon mode. Calls that would not change
+//  anything are dropped and counted. Code that binds through glState() must also
+//  delete through it (or call invalidate()) so the cache never goes stale.
+//
+
+#ifndef GL_STATE_CACHE_H
+#define GL_STATE_CACHE_H
+
+#include <glad/glad.h>
+
+#include <iostream>
+#include <cstddef>
+
+class GLStateCache
+{
+public:
+    // per-frame counters, reset by beginFrame()
+    size_t issued = 0;
+    size_t dropped = 0;
+    // totals over every finished frame
+    size_t frames = 0;
+    size_t totalIssued = 0;
+    size_t totalDropped = 0;
+
+    GLStateCache()
+    {
+        invalidate();
+    }
+    // forget everything; the next call of every kind reaches the driver
+    // ------------------------------------------------------------------------
+    void invalidate()
+    {
+        program = UNKNOWN;
+        vertexArray = UNKNOWN;
+        for (int i = 0; i < BUFFER_TARGET_COUNT; i++)
+            buffers[i] = UNKNOWN;
+        for (int i = 0; i < CAPABILITY_COUNT; i++)
+            capabilities[i] = STATE_UNKNOWN;
+        blendSrc = blendDst = UNKNOWN;
+        depthFunction = UNKNOWN;
+        depthWrite = STATE_UNKNOWN;
+        polygonModeFront = polygonModeBack = UNKNOWN;
+    }
+    // ------------------------------------------------------------------------
+    void beginFrame()
+    {
+        if (issued != 0 || dropped != 0)
+        {
+            frames++;
+            totalIssued += issued;
+            totalDropped += dropped;
+        }
+        issued = 0;
+        dropped = 0;
+    }
+    // ------------------------------------------------------------------------
+    void useProgram(GLuint id)
+    {
+        if (program == id)
+        {
+            dropped++;
+            return;
+        }
+        program = id;
+        issued++;
+        glUseProgram(id);
+    }
+    // ------------------------------------------------------------------------
+    void bindVertexArray(GLuint id)
+    {
+        if (vertexArray == id)
+        {
+            dropped++;
+            return;
+        }
+        vertexArray = id;
+        // the element buffer binding belongs to the VAO
+        buffers[targetIndex(GL_ELEMENT_ARRAY_BUFFER)] = UNKNOWN;
+        issued++;
+        glBindVertexArray(id);
+    }
+    // ------------------------------------------------------------------------
+    void bindBuffer(GLenum target, GLuint id)
+    {
+        int index = targetIndex(target);
+        if (index >= 0 && buffers[index] == id)
+        {
+            dropped++;
+            return;
+        }
+        if (index >= 0)
+            buffers[index] = id;
+        issued++;
+        glBindBuffer(target, id);
+    }
+    // ------------------------------------------------------------------------
+    void enable(GLenum capability)
+    {
+        setCapability(capability, true);
+    }
+    void disable(GLenum capability)
+    {
+        setCapability(capability, false);
+    }
+    // ------------------------------------------------------------------------
+    void blendFunc(GLenum src, GLenum dst)
+    {
+        if (blendSrc == src && blendDst == dst)
+        {
+            dropped++;
+            return;
+        }
+        blendSrc = src;
+        blendDst = dst;
+        issued++;
+        glBlendFunc(src, dst);
+    }
+    // ------------------------------------------------------------------------
+    void depthFunc(GLenum func)
+    {
+        if (depthFunction == func)
+        {
+            dropped++;
+            return;
+        }
+        depthFunction = func;
+        issued++;
+        glDepthFunc(func);
+    }
+    void depthMask(bool write)
+    {
+        int state = write ? STATE_ON : STATE_OFF;
+        if (depthWrite == state)
+        {
+            dropped++;
+            return;
+        }
+        depthWrite = state;
+        issued++;
+        glDepthMask(write ? GL_TRUE : GL_FALSE);
+    }
+    // ------------------------------------------------------------------------
+    void polygonMode(GLenum face, GLenum mode)
+    {
+        bool front = (face == GL_FRONT || face == GL_FRONT_AND_BACK);
+        bool back = (face == GL_BACK || face == GL_FRONT_AND_BACK);
+        if ((!front || polygonModeFront == mode) && (!back || polygonModeBack == mode))
+        {
+            dropped++;
+            return;
+        }
+        if (front)
+            polygonModeFront = mode;
+        if (back)
+            polygonModeBack = mode;
+        issued++;
+        glPolygonMode(face, mode);
+    }
+    // deletion goes through the cache so a recycled name is never mistaken for the bound one
+    // ------------------------------------------------------------------------
+    void deleteProgram(GLuint id)
+    {
+        if (program == id)
+            program = UNKNOWN;
+        glDeleteProgram(id);
+    }
+    void deleteVertexArray(GLuint id)
+    {
+        if (vertexArray == id)
+            vertexArray = UNKNOWN;
+        buffers[targetIndex(GL_ELEMENT_ARRAY_BUFFER)] = UNKNOWN;
+        glDeleteVertexArrays(1, &id);
+    }
+    void deleteBuffer(GLuint id)
+    {
+        for (int i = 0; i < BUFFER_TARGET_COUNT; i++)
+            if (buffers[i] == id)
+                buffers[i] = UNKNOWN;
+        glDeleteBuffers(1, &id);
+    }
+    // ------------------------------------------------------------------------
+    GLuint currentProgram() const
+    {
+        return program;
+    }
+    GLuint currentVertexArray() const
+    {
+        return vertexArray;
+    }
+    // ------------------------------------------------------------------------
+    void printStats() const
+    {
+        size_t n = frames > 0 ? frames : 1;
+        std::cout << "GLStateCache: " << frames << " frames, " << totalIssued / n << " state calls issued and "
+            << totalDropped / n << " dropped per frame" << std::endl;
+    }
+
+private:
+    static const GLuint UNKNOWN = 0xFFFFFFFFu;
+    enum { STATE_UNKNOWN = -1, STATE_OFF = 0, STATE_ON = 1 };
+    enum { BUFFER_TARGET_COUNT = 6, CAPABILITY_COUNT = 6 };
+
+    GLuint program;
+    GLuint vertexArray;
+    GLuint buffers[BUFFER_TARGET_COUNT];
+    int capabilities[CAPABILITY_COUNT];
+    GLenum blendSrc, blendDst;
+    GLenum depthFunction;
+    int depthWrite;
+    GLenum polygonModeFront, polygonModeBack;
+
+    // ------------------------------------------------------------------------
+    static int targetIndex(GLenum target)
+    {
+        switch (target)
+        {
+        case GL_ARRAY_BUFFER: return 0;
+        case GL_ELEMENT_ARRAY_BUFFER: return 1;
+        case GL_UNIFORM_BUFFER: return 2;
+        case GL_PIXEL_PACK_BUFFER: return 3;
+        case GL_PIXEL_UNPACK_BUFFER: return 4;
+        case GL_COPY_WRITE_BUFFER: return 5;
+        default: return -1;
+        }
+    }
+    static int capabilityIndex(GLenum capability)
+    {
+        switch (capability)
+        {
+        case GL_DEPTH_TEST: return 0;
+        case GL_BLEND: return 1;
+        case GL_CULL_FACE: return 2;
+        case GL_SCISSOR_TEST: return 3;
+        case GL_STENCIL_TEST: return 4;
+        case GL_POLYGON_OFFSET_FILL: return 5;
+        default: return -1;
+        }
+    }
+    // ------------------------------------------------------------------------
+    void setCapability(GLenum capability, bool on)
+    {
+        int index = capabilityIndex(capability);
+        int state = on ? STATE_ON : STATE_OFF;
+        if (index >= 0 && capabilities[index] == state)
+        {
+            dropped++;
+            return;
+        }
+        if (index >= 0)
+            capabilities[index] = state;
+        issued++;
+        if (on)
+            glEnable(capability);
+        else
+            glDisable(capability);
+    }
+};
+
+// one cache per process; both labs render from a single context on one thread
+// ------------------------------------------------------------------------
+inline GLStateCache& glState()
+{
+    static GLStateCache cache;
+    return cache;
+}
+
+#endif
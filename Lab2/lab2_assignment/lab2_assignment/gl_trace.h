@@ -0,0 +1,322 @@
+#pragma once
+//
+//  gl_trace.h
+//  3D Object Drawing
+//
+//  Optional interception of the GL entry points glad loaded. installGLTrace()
+//  swaps each glad_gl* pointer listed in GL_TRACE_FUNCTIONS for a wrapper that
+//  counts the call for the current frame, optionally times it on the CPU and
+//  writes it with its arguments to a log, then calls the driver. Tracing is
+//  compiled in like the profiler (debug builds, or GL_TRACE_IN_RELEASE); a
+//  release build has no wrappers, and nothing is swapped unless asked for.
+//
+
+#ifndef GL_TRACE_H
+#define GL_TRACE_H
+
+#include <glad/glad.h>
+
+#if !defined(NDEBUG) || defined(GL_TRACE_IN_RELEASE)
+#define GL_TRACE_ENABLED 1
+#endif
+
+#include <string>
+#include <iostream>
+#include <cstddef>
+
+#ifdef GL_TRACE_ENABLED
+
+#include <vector>
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <chrono>
+#include <type_traits>
+#include <cstdint>
+
+// every entry point the labs call; add a line here to trace another one
+#define GL_TRACE_FUNCTIONS(X) \
+    X(glActiveTexture) X(glAttachShader) X(glBindBuffer) X(glBindBufferBase) X(glBindFramebuffer) \
+    X(glBindRenderbuffer) X(glBindTexture) X(glBindVertexArray) X(glBlendFunc) X(glBufferData) X(glBufferSubData) \
+    X(glCheckFramebufferStatus) X(glClear) X(glClearColor) X(glClientWaitSync) X(glCompileShader) \
+    X(glCreateProgram) X(glCreateShader) X(glCullFace) X(glDeleteBuffers) X(glDeleteFramebuffers) \
+    X(glDeleteProgram) X(glDeleteQueries) X(glDeleteRenderbuffers) X(glDeleteShader) X(glDeleteSync) \
+    X(glDeleteVertexArrays) X(glDepthFunc) X(glDepthMask) X(glDisable) X(glDrawArrays) \
+    X(glDrawArraysInstanced) X(glDrawElements) X(glDrawElementsInstanced) X(glEnable) \
+    X(glEnableVertexAttribArray) X(glFenceSync) X(glFinish) X(glFlush) X(glFramebufferRenderbuffer) \
+    X(glGenBuffers) X(glGenFramebuffers) X(glGenQueries) X(glGenRenderbuffers) X(glGenVertexArrays) \
+    X(glGetActiveUniform) X(glGetError) X(glGetIntegerv) X(glGetProgramInfoLog) X(glGetProgramiv) \
+    X(glGetQueryObjectiv) X(glGetQueryObjectui64v) X(glGetShaderInfoLog) X(glGetShaderiv) X(glGetString) \
+    X(glGetUniformBlockIndex) X(glGetUniformLocation) X(glLinkProgram) X(glMapBufferRange) \
+    X(glPixelStorei) X(glPolygonMode) X(glQueryCounter) X(glReadPixels) X(glRenderbufferStorage) X(glShaderSource) \
+    X(glUniform1f) X(glUniform1i) X(glUniform2f) X(glUniform2fv) X(glUniform3f) X(glUniform3fv) \
+    X(glUniform4f) X(glUniform4fv) X(glUniformBlockBinding) X(glUniformMatrix2fv) X(glUniformMatrix3fv) \
+    X(glUniformMatrix4fv) X(glUnmapBuffer) X(glUseProgram) X(glVertexAttribDivisor) X(glVertexAttribPointer) \
+    X(glViewport)
+
+enum GLTraceEntry
+{
+#define GL_TRACE_ENUM(name) GL_TRACE_##name,
+    GL_TRACE_FUNCTIONS(GL_TRACE_ENUM)
+#undef GL_TRACE_ENUM
+    GL_TRACE_ENTRY_COUNT
+};
+
+// frames whose calls "--gl-trace-log" writes out, counted from installation
+const size_t GL_TRACE_LOG_FRAMES = 2;
+
+// arguments as they appear in the log: numbers as numbers, pointers as addresses
+// ------------------------------------------------------------------------
+template <typename T>
+inline void describeGLArgument(std::ostream& out, T value, std::true_type /*pointer*/)
+{
+    if (value)
+        out << (const void*)value;
+    else
+        out << "NULL";
+}
+template <typename T>
+inline void describeGLArgument(std::ostream& out, T value, std::false_type /*pointer*/)
+{
+    out << +value;      // promotes GLboolean/GLubyte so they print as numbers
+}
+
+class GLTrace
+{
+public:
+    bool installed = false;
+    bool timing = false;
+    // per-entry counters of the frame in progress, of the last finished frame and over every finished frame
+    size_t frameCalls[GL_TRACE_ENTRY_COUNT] = {};
+    size_t lastFrameCalls[GL_TRACE_ENTRY_COUNT] = {};
+    size_t totalCalls[GL_TRACE_ENTRY_COUNT] = {};
+    uint64_t totalNs[GL_TRACE_ENTRY_COUNT] = {};
+    size_t frames = 0;
+
+    static const char* name(int entry)
+    {
+        static const char* names[] = {
+#define GL_TRACE_NAME(name) #name,
+            GL_TRACE_FUNCTIONS(GL_TRACE_NAME)
+#undef GL_TRACE_NAME
+        };
+        return names[entry];
+    }
+    // ------------------------------------------------------------------------
+    void count(int entry)
+    {
+        frameCalls[entry]++;
+    }
+    void addTime(int entry, uint64_t ns)
+    {
+        totalNs[entry] += ns;
+    }
+    // calls of the frame in progress, over every entry point
+    size_t callsThisFrame() const
+    {
+        size_t calls = 0;
+        for (int i = 0; i < GL_TRACE_ENTRY_COUNT; i++)
+            calls += frameCalls[i];
+        return calls;
+    }
+    // tallies the frame in progress; a frame without calls is not counted
+    // ------------------------------------------------------------------------
+    void endFrame()
+    {
+        if (!installed || callsThisFrame() == 0)
+            return;
+        frames++;
+        for (int i = 0; i < GL_TRACE_ENTRY_COUNT; i++)
+        {
+            totalCalls[i] += frameCalls[i];
+            lastFrameCalls[i] = frameCalls[i];
+            frameCalls[i] = 0;
+        }
+        if (log.is_open() && frames >= GL_TRACE_LOG_FRAMES)
+            log.close();
+        else if (log.is_open())
+            log << "---- end of frame " << frames << std::endl;
+    }
+    // drops the counts of the calls made so far (loading, setup) so they do not count as a frame
+    // ------------------------------------------------------------------------
+    void endSetup()
+    {
+        for (int i = 0; i < GL_TRACE_ENTRY_COUNT; i++)
+            frameCalls[i] = 0;
+        if (log.is_open())
+            log << "---- end of setup" << std::endl;
+    }
+    // logs every call of the first GL_TRACE_LOG_FRAMES frames, with its arguments, to path
+    // ------------------------------------------------------------------------
+    bool openLog(const std::string& path)
+    {
+        log.open(path.c_str());
+        if (!log)
+        {
+            std::cout << "ERROR::GL_TRACE::LOG_NOT_OPENED " << path << std::endl;
+            return false;
+        }
+        return true;
+    }
+    bool logging() const
+    {
+        return log.is_open();
+    }
+    template <typename... Args>
+    void logCall(int entry, Args... args)
+    {
+        log << name(entry) << "(";
+        const char* separator = "";
+        int expand[] = { 0, (log << separator, describeGLArgument(log, args, std::is_pointer<Args>()), separator = ", ", 0)... };
+        (void)expand;
+        (void)separator;
+        log << ")\n";
+    }
+    // the busiest entry points, per finished frame
+    // ------------------------------------------------------------------------
+    void printStats(size_t top = 12) const
+    {
+        if (!installed)
+            return;
+        size_t n = frames > 0 ? frames : 1;
+        std::vector<int> order;
+        size_t calls = 0;
+        for (int i = 0; i < GL_TRACE_ENTRY_COUNT; i++)
+            if (totalCalls[i] > 0)
+            {
+                order.push_back(i);
+                calls += totalCalls[i];
+            }
+        std::sort(order.begin(), order.end(), [this](int a, int b) { return totalCalls[a] > totalCalls[b]; });
+
+        std::cout << "GLTrace: " << frames << " frames, " << (double)calls / n << " GL calls per frame over "
+            << order.size() << " entry points" << std::endl;
+        std::cout << std::fixed << std::setprecision(1);
+        for (size_t k = 0; k < order.size() && k < top; k++)
+        {
+            int i = order[k];
+            std::cout << "  " << std::setw(28) << std::left << name(i) << std::right << std::setw(10)
+                << (double)totalCalls[i] / n << " per frame";
+            if (timing)
+                std::cout << std::setw(10) << (double)totalNs[i] / totalCalls[i] << " ns per call";
+            std::cout << std::endl;
+        }
+        std::cout << std::defaultfloat << std::setprecision(6);
+    }
+
+private:
+    std::ofstream log;
+};
+
+// one tracer per process; GL is only called from the thread that owns the context
+// ------------------------------------------------------------------------
+inline GLTrace& glTrace()
+{
+    static GLTrace trace;
+    return trace;
+}
+
+// adds the time until it goes out of scope to an entry point
+struct GLTraceCallTimer
+{
+    int entry;
+    std::chrono::steady_clock::time_point start;
+
+    ~GLTraceCallTimer()
+    {
+        glTrace().addTime(entry, (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count());
+    }
+};
+
+// the wrapper of one entry point: the driver's pointer is kept in real
+template <int Entry, typename Function>
+struct GLTraceHook;
+
+template <int Entry, typename Result, typename... Args>
+struct GLTraceHook<Entry, Result (APIENTRYP)(Args...)>
+{
+    typedef Result (APIENTRYP Function)(Args...);
+    static Function real;
+
+    static Result APIENTRY call(Args... args)
+    {
+        GLTrace& trace = glTrace();
+        trace.count(Entry);
+        if (trace.logging())
+            trace.logCall(Entry, args...);
+        if (!trace.timing)
+            return real(args...);
+        GLTraceCallTimer timer = { Entry, std::chrono::steady_clock::now() };
+        return real(args...);
+    }
+    // ------------------------------------------------------------------------
+    static void install(Function& pointer)
+    {
+        if (pointer && pointer != &call)
+        {
+            real = pointer;
+            pointer = &call;
+        }
+    }
+    static void uninstall(Function& pointer)
+    {
+        if (real && pointer == &call)
+            pointer = real;
+    }
+};
+
+template <int Entry, typename Result, typename... Args>
+typename GLTraceHook<Entry, Result (APIENTRYP)(Args...)>::Function GLTraceHook<Entry, Result (APIENTRYP)(Args...)>::real = NULL;
+
+// swaps the glad pointers for the wrappers; call after gladLoadGLLoader(), on the context's thread
+// ------------------------------------------------------------------------
+inline void installGLTrace(bool timeCalls)
+{
+#define GL_TRACE_INSTALL(name) GLTraceHook<GL_TRACE_##name, decltype(glad_##name)>::install(glad_##name);
+    GL_TRACE_FUNCTIONS(GL_TRACE_INSTALL)
+#undef GL_TRACE_INSTALL
+    glTrace().installed = true;
+    glTrace().timing = timeCalls;
+}
+// puts the driver's pointers back
+// ------------------------------------------------------------------------
+inline void uninstallGLTrace()
+{
+#define GL_TRACE_UNINSTALL(name) GLTraceHook<GL_TRACE_##name, decltype(glad_##name)>::uninstall(glad_##name);
+    GL_TRACE_FUNCTIONS(GL_TRACE_UNINSTALL)
+#undef GL_TRACE_UNINSTALL
+    glTrace().installed = false;
+}
+
+#else
+
+// release: the same calls, with nothing behind them
+class GLTrace
+{
+public:
+    static const bool installed = false;
+    size_t callsThisFrame() const { return 0; }
+    void endSetup() {}
+    void endFrame() {}
+    bool openLog(const std::string&) { return false; }
+    void printStats(size_t = 0) const {}
+};
+
+inline GLTrace& glTrace()
+{
+    static GLTrace trace;
+    return trace;
+}
+
+inline void installGLTrace(bool)
+{
+    std::cout << "WARNING::GL_TRACE::DISABLED not compiled into this build (define GL_TRACE_IN_RELEASE)" << std::endl;
+}
+inline void uninstallGLTrace()
+{
+}
+
+#endif
+
+#endif
@@ -0,0 +1,135 @@
+#pragma once
+//
+//  golden.h
+//  3D Object Drawing
+//
+//  Golden-image regression suite for "--golden <dir>". Each named frame is
+//  read back and compared with <dir>/<name>.ppm by diffImages(); a missing
+//  reference is written as new, and "--golden-update" rewrites them all. A
+//  frame that fails leaves <name>.actual.ppm and a <name>.diff.ppm heat map
+//  next to its reference. References are binary PPM so they are read back
+//  without a decoder.
+//
+
+#ifndef GOLDEN_H
+#define GOLDEN_H
+
+#include <glad/glad.h>
+
+#include "gl_state_cache.h"
+#include "image_io.h"
+#include "image_diff.h"
+#include "worker_pool.h"
+
+#include <string>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cstring>
+
+// reads the bound read framebuffer into image, top row first
+// ------------------------------------------------------------------------
+inline void readFramebuffer(int width, int height, Image& image)
+{
+    image.resize(width, height);
+    std::vector<uint8_t> pixels(image.rgba.size());
+    glState().bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+    size_t rowBytes = (size_t)width * 4;
+    for (int y = 0; y < height; y++)
+        std::memcpy(image.row(y), &pixels[rowBytes * (height - 1 - y)], rowBytes);
+}
+
+class GoldenSuite
+{
+public:
+    ImageDiffOptions options;
+    int passed = 0, failed = 0, created = 0;
+    double compareMs = 0.0;
+
+    // ------------------------------------------------------------------------
+    void init(const std::string& referenceDir, bool updateReferences, unsigned int workerCount = 0)
+    {
+        dir = referenceDir;
+        if (!dir.empty() && dir[dir.size() - 1] != '/' && dir[dir.size() - 1] != '\\')
+            dir += '/';
+        update = updateReferences;
+        workers.start(workerCount);
+    }
+    // compares one frame with its reference; false when it fails
+    // ------------------------------------------------------------------------
+    bool check(const std::string& name, const Image& actual)
+    {
+        std::string referencePath = dir + name + ".ppm";
+        Image expected;
+        if (update || !std::ifstream(referencePath.c_str()).good())
+        {
+            bool written = writePPM(referencePath, actual);
+            if (written)
+                created++;
+            else
+                failed++;
+            std::cout << (written ? "NEW  " : "FAIL ") << name << " -> " << referencePath << std::endl;
+            return written;
+        }
+        if (!readPPM(referencePath, expected))
+        {
+            failed++;
+            return false;
+        }
+
+        std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+        ImageDiffResult result = diffImages(expected, actual, options, &workers);
+        compareMs += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+        std::cout << (result.passed ? "PASS " : "FAIL ") << name;
+        if (!result.sizeMatches)
+            std::cout << ": size " << actual.width << "x" << actual.height << ", reference "
+                << expected.width << "x" << expected.height;
+        else
+            std::cout << std::fixed << std::setprecision(4) << ": " << result.badPixels << " pixels over "
+                << options.tolerance << " (" << 100.0 * result.badFraction() << "%), max diff " << result.maxDiff
+                << ", PSNR " << std::setprecision(2) << result.psnr << " dB, SSIM " << std::setprecision(4) << result.ssim
+                << std::defaultfloat;
+        std::cout << std::endl;
+
+        if (result.passed)
+        {
+            passed++;
+            return true;
+        }
+        failed++;
+        Image heatMap;
+        diffHeatMap(expected, actual, options.tolerance, heatMap);
+        writePPM(dir + name + ".actual.ppm", actual);
+        writePPM(dir + name + ".diff.ppm", heatMap);
+        return false;
+    }
+    // ------------------------------------------------------------------------
+    void printSummary() const
+    {
+        int compared = passed + failed;
+        std::cout << "Golden images: " << passed << " passed, " << failed << " failed, " << created << " written; "
+            << (compared > 0 ? compareMs / compared : 0.0) << " ms per comparison on " << workers.size() + 1
+            << " threads" << std::endl;
+    }
+    // ------------------------------------------------------------------------
+    bool succeeded() const
+    {
+        return failed == 0;
+    }
+    // ------------------------------------------------------------------------
+    void clear()
+    {
+        workers.stop();
+    }
+
+private:
+    std::string dir;
+    bool update = false;
+    WorkerPool workers;
+};
+
+#endif
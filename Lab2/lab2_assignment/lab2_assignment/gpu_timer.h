@@ -0,0 +1,212 @@
+#pragma once
+//
+//  gpu_timer.h
+//  3D Object Drawing
+//
+//  Named GPU timing scopes. begin()/end() each write a GL_TIMESTAMP query, so
+//  scopes may nest (the whole frame is one scope around the others). Queries
+//  live in a ring of GPU_TIMER_FRAMES sets; a frame's results are read when its
+//  set comes round again, by which time the GPU has long finished it, so the
+//  CPU never waits on a query. A result that is still not ready is skipped.
+//
+
+#ifndef GPU_TIMER_H
+#define GPU_TIMER_H
+
+#include <glad/glad.h>
+
+#include <string>
+#include <vector>
+#include <iostream>
+#include <iomanip>
+#include <cstddef>
+#include <cstdint>
+
+// frames in flight before a set of queries is read back
+const int GPU_TIMER_FRAMES = 4;
+// seconds between the periodic printouts of the interactive scene
+const double GPU_TIMER_PRINT_SECONDS = 5.0;
+
+typedef int GpuScope;
+const GpuScope NO_GPU_SCOPE = -1;
+
+struct GpuScopeStats
+{
+    std::string name;
+    double lastMs = 0.0;        // most recent frame read back
+    double totalMs = 0.0;
+    double maxMs = 0.0;
+    size_t samples = 0;
+
+    double averageMs() const
+    {
+        return samples > 0 ? totalMs / samples : 0.0;
+    }
+};
+
+class GpuTimer
+{
+public:
+    size_t framesRead = 0;
+    size_t resultsSkipped = 0;      // frames whose queries were not ready when their set came round
+
+    // timestamps are core in 3.3; without them every call is a no-op
+    // ------------------------------------------------------------------------
+    bool init()
+    {
+        enabled = GLAD_GL_VERSION_3_3 && glQueryCounter != NULL;
+        if (!enabled)
+            std::cout << "WARNING::GPU_TIMER::NO_TIMESTAMP_QUERIES" << std::endl;
+        frame = 0;
+        return enabled;
+    }
+    // registers a scope; call before the first frame
+    // ------------------------------------------------------------------------
+    GpuScope scope(const char* name)
+    {
+        GpuScopeStats stats;
+        stats.name = name;
+        scopes.push_back(stats);
+        GpuScope id = (GpuScope)scopes.size() - 1;
+        for (int f = 0; f < GPU_TIMER_FRAMES; f++)
+        {
+            Slot slot;
+            slot.written = false;
+            if (enabled)
+                glGenQueries(2, slot.queries);
+            sets[f].push_back(slot);
+        }
+        return id;
+    }
+    // moves to the next set of the ring, first collecting what that set measured GPU_TIMER_FRAMES frames ago
+    // ------------------------------------------------------------------------
+    void beginFrame()
+    {
+        if (!enabled)
+            return;
+        frame = (frame + 1) % GPU_TIMER_FRAMES;
+        collect(frame, false);
+    }
+    // ------------------------------------------------------------------------
+    void begin(GpuScope id)
+    {
+        if (!enabled || id < 0)
+            return;
+        Slot& slot = sets[frame][id];
+        glQueryCounter(slot.queries[0], GL_TIMESTAMP);
+        slot.written = false;
+    }
+    // a scope is measured once per frame; a second begin()/end() pair replaces the first
+    void end(GpuScope id)
+    {
+        if (!enabled || id < 0)
+            return;
+        Slot& slot = sets[frame][id];
+        glQueryCounter(slot.queries[1], GL_TIMESTAMP);
+        slot.written = true;
+    }
+    // waits for every frame still in flight, e.g. before reporting at exit
+    // ------------------------------------------------------------------------
+    void flush()
+    {
+        if (!enabled)
+            return;
+        for (int f = 1; f <= GPU_TIMER_FRAMES; f++)
+            collect((frame + f) % GPU_TIMER_FRAMES, true);
+    }
+    // ------------------------------------------------------------------------
+    size_t size() const
+    {
+        return scopes.size();
+    }
+    const GpuScopeStats& stats(GpuScope id) const
+    {
+        return scopes[id];
+    }
+    bool available() const
+    {
+        return enabled;
+    }
+    // prints the averages once every interval seconds of now
+    // ------------------------------------------------------------------------
+    void printPeriodic(double now, double interval = GPU_TIMER_PRINT_SECONDS)
+    {
+        if (!enabled || now - lastPrint < interval)
+            return;
+        lastPrint = now;
+        printStats();
+    }
+    // ------------------------------------------------------------------------
+    void printStats() const
+    {
+        if (!enabled)
+            return;
+        std::cout << "GpuTimer (" << framesRead << " frames, " << resultsSkipped << " skipped):";
+        std::cout << std::fixed << std::setprecision(3);
+        for (size_t i = 0; i < scopes.size(); i++)
+            std::cout << " " << scopes[i].name << " " << scopes[i].averageMs() << " ms";
+        std::cout << std::defaultfloat << std::setprecision(6) << std::endl;
+    }
+    // ------------------------------------------------------------------------
+    void clear()
+    {
+        if (enabled)
+            for (int f = 0; f < GPU_TIMER_FRAMES; f++)
+                for (size_t i = 0; i < sets[f].size(); i++)
+                    glDeleteQueries(2, sets[f][i].queries);
+        for (int f = 0; f < GPU_TIMER_FRAMES; f++)
+            sets[f].clear();
+        scopes.clear();
+    }
+
+private:
+    struct Slot
+    {
+        GLuint queries[2];      // begin and end timestamps
+        bool written;           // end() ran since the last read
+    };
+
+    bool enabled = false;
+    int frame = 0;
+    double lastPrint = 0.0;
+    std::vector<GpuScopeStats> scopes;
+    std::vector<Slot> sets[GPU_TIMER_FRAMES];
+
+    void collect(int set, bool wait)
+    {
+        bool any = false, skipped = false;
+        for (size_t i = 0; i < sets[set].size(); i++)
+        {
+            Slot& slot = sets[set][i];
+            if (!slot.written)
+                continue;
+            GLint ready = GL_TRUE;
+            if (!wait)
+                glGetQueryObjectiv(slot.queries[1], GL_QUERY_RESULT_AVAILABLE, &ready);
+            if (!ready)
+            {
+                skipped = true;
+                slot.written = false;
+                continue;
+            }
+            GLuint64 start = 0, stop = 0;
+            glGetQueryObjectui64v(slot.queries[0], GL_QUERY_RESULT, &start);
+            glGetQueryObjectui64v(slot.queries[1], GL_QUERY_RESULT, &stop);
+            slot.written = false;
+
+            GpuScopeStats& stats = scopes[i];
+            stats.lastMs = (double)(stop - start) * 1e-6;
+            stats.totalMs += stats.lastMs;
+            if (stats.lastMs > stats.maxMs)
+                stats.maxMs = stats.lastMs;
+            stats.samples++;
+            any = true;
+        }
+        if (any)
+            framesRead++;
+        if (skipped)
+            resultsSkipped++;
+    }
+};
+
+#endif
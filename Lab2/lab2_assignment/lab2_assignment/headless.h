@@ -0,0 +1,203 @@
+#pragma once
+//
+//  headless.h
+//  3D Object Drawing
+//
+//  Support for "--headless": the scene renders into an offscreen framebuffer of
+//  a hidden window for a fixed number of frames while the camera follows a
+//  deterministic orbit, and per-frame cost is collected into a JSON report
+//  (frame-time percentiles, draw calls, triangles, GL state changes and peak
+//  process memory) that runs on different machines can be compared by.
+//
+
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "basic_camera.h"
+#include "frustum.h"
+#include "gpu_timer.h"
+#include "offscreen_target.h"
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <sys/resource.h>
+#endif
+
+// frames rendered by "--headless" unless "--frames" says otherwise
+const int DEFAULT_HEADLESS_FRAMES = 600;
+// simulated time per headless frame, so every run animates identically
+const double HEADLESS_FRAME_SECONDS = 1.0 / 60.0;
+
+// one orbit of period seconds around the middle of bounds, at eye height, looking slightly down
+// ------------------------------------------------------------------------
+inline void followCameraPath(BasicCamera& camera, const AABB& bounds, double time, double period)
+{
+    glm::vec3 center = (bounds.min + bounds.max) * 0.5f;
+    glm::vec3 half = (bounds.max - bounds.min) * 0.5f;
+    float radius = 0.7f * std::min(half.x, half.z);
+    float angle = (float)(6.283185307179586 * std::fmod(time, period) / period);
+
+    camera.Position = glm::vec3(center.x + radius * std::cos(angle), bounds.min.y + 1.6f, center.z + radius * std::sin(angle));
+    glm::vec3 target(center.x, bounds.min.y + 1.0f, center.z);
+    glm::vec3 direction = glm::normalize(target - camera.Position);
+    camera.Yaw = glm::degrees(std::atan2(direction.z, direction.x));
+    camera.Pitch = glm::degrees(std::asin(direction.y));
+    camera.Roll = 0.0f;
+    camera.updateCameraVectors();
+}
+
+// peak resident memory of the process in bytes
+// ------------------------------------------------------------------------
+inline size_t peakMemoryBytes()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return (size_t)counters.PeakWorkingSetSize;
+    return 0;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+#ifdef __APPLE__
+    return (size_t)usage.ru_maxrss;             // bytes on macOS
+#else
+    return (size_t)usage.ru_maxrss * 1024;      // kilobytes on Linux
+#endif
+#endif
+}
+
+struct HeadlessFrame
+{
+    double ms;              // CPU time until the GPU finished the frame
+    size_t drawCalls;
+    size_t triangles;
+    size_t stateChanges;    // GL state calls that reached the driver
+};
+
+class HeadlessReport
+{
+public:
+    std::vector<HeadlessFrame> frames;
+
+    // ------------------------------------------------------------------------
+    void record(double ms, size_t drawCalls, size_t triangles, size_t stateChanges)
+    {
+        HeadlessFrame frame = { ms, drawCalls, triangles, stateChanges };
+        frames.push_back(frame);
+    }
+    // nearest-rank percentile of the frame times, p in [0, 100]
+    // ------------------------------------------------------------------------
+    double percentile(double p) const
+    {
+        if (frames.empty())
+            return 0.0;
+        std::vector<double> times(frames.size());
+        for (size_t i = 0; i < frames.size(); i++)
+            times[i] = frames[i].ms;
+        std::sort(times.begin(), times.end());
+        size_t rank = (size_t)std::ceil(p / 100.0 * times.size());
+        return times[rank > 0 ? rank - 1 : 0];
+    }
+    // the report as a JSON object; with gpu, the average and worst time of each of its scopes are included
+    // ------------------------------------------------------------------------
+    std::string toJSON(const std::string& scene, size_t sceneNodes, int width, int height, const char* renderer,
+        const GpuTimer* gpu = NULL) const
+    {
+        size_t n = frames.empty() ? 1 : frames.size();
+        double totalMs = 0.0;
+        size_t drawCalls = 0, triangles = 0, stateChanges = 0;
+        for (size_t i = 0; i < frames.size(); i++)
+        {
+            totalMs += frames[i].ms;
+            drawCalls += frames[i].drawCalls;
+            triangles += frames[i].triangles;
+            stateChanges += frames[i].stateChanges;
+        }
+
+        std::ostringstream json;
+        json << std::fixed << std::setprecision(4);
+        json << "{\n";
+        json << "  \"scene\": \"" << escape(scene) << "\",\n";
+        json << "  \"scene_nodes\": " << sceneNodes << ",\n";
+        json << "  \"renderer\": \"" << escape(renderer ? renderer : "") << "\",\n";
+        json << "  \"width\": " << width << ",\n";
+        json << "  \"height\": " << height << ",\n";
+        json << "  \"frames\": " << frames.size() << ",\n";
+        json << "  \"frame_ms\": { \"mean\": " << totalMs / n << ", \"p50\": " << percentile(50.0)
+            << ", \"p95\": " << percentile(95.0) << ", \"p99\": " << percentile(99.0)
+            << ", \"max\": " << percentile(100.0) << " },\n";
+        json << "  \"draw_calls_per_frame\": " << (double)drawCalls / n << ",\n";
+        json << "  \"triangles_per_frame\": " << (double)triangles / n << ",\n";
+        json << "  \"state_changes_per_frame\": " << (double)stateChanges / n << ",\n";
+        if (gpu && gpu->available())
+        {
+            json << "  \"gpu_ms\": {";
+            for (GpuScope i = 0; i < (GpuScope)gpu->size(); i++)
+            {
+                const GpuScopeStats& stats = gpu->stats(i);
+                json << (i > 0 ? "," : "") << "\n    \"" << escape(stats.name) << "\": { \"mean\": " << stats.averageMs()
+                    << ", \"max\": " << stats.maxMs << ", \"samples\": " << stats.samples << " }";
+            }
+            json << "\n  },\n";
+        }
+        json << "  \"peak_memory_bytes\": " << peakMemoryBytes() << "\n";
+        json << "}\n";
+        return json.str();
+    }
+    // prints the report and, given a path, also writes it there
+    // ------------------------------------------------------------------------
+    bool write(const std::string& path, const std::string& json) const
+    {
+        std::cout << json;
+        if (path.empty())
+            return true;
+        std::ofstream file(path.c_str());
+        file << json;
+        if (!file)
+        {
+            std::cout << "ERROR::HEADLESS::REPORT_NOT_WRITTEN " << path << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+private:
+    static std::string escape(const std::string& text)
+    {
+        std::string out;
+        for (size_t i = 0; i < text.size(); i++)
+        {
+            char c = text[i];
+            if (c == '"' || c == '\\')
+                out += '\\';
+            if ((unsigned char)c >= 0x20)
+                out += c;
+        }
+        return out;
+    }
+};
+
+#endif
@@ -0,0 +1,322 @@
+#pragma once
+//
+//  image_diff.h
+//  3D Object Drawing
+//
+//  Tolerance-aware comparison of two RGBA8 images of the same size. A pixel
+//  differs when any color channel is off by more than the tolerance; the
+//  result counts those pixels and also reports the largest channel error,
+//  PSNR, and SSIM of the luma over 8x8 blocks, so a rendering change that
+//  shifts every pixel by one step is told apart from one that moves an edge.
+//  Both passes use SSE2 (4 pixels at a time per pixel, one 8-pixel block row
+//  at a time for SSIM) and are split into row bands over a worker pool.
+//  Alpha is ignored.
+//
+
+#ifndef IMAGE_DIFF_H
+#define IMAGE_DIFF_H
+
+#include "image_io.h"
+#include "worker_pool.h"
+
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+// rows per parallel band; a multiple of the SSIM block size
+const int IMAGE_DIFF_BAND_ROWS = 64;
+const int IMAGE_DIFF_SSIM_BLOCK = 8;
+
+struct ImageDiffOptions
+{
+    int tolerance = 8;                  // largest channel difference that still matches
+    double maxBadFraction = 0.001;      // of pixels allowed beyond the tolerance
+    double minSSIM = 0.99;
+};
+
+struct ImageDiffResult
+{
+    bool sizeMatches = false;
+    size_t pixels = 0;
+    size_t badPixels = 0;
+    int maxDiff = 0;
+    double psnr = 0.0;                  // dB, infinite for identical images
+    double ssim = 0.0;
+    bool passed = false;
+
+    double badFraction() const
+    {
+        return pixels > 0 ? (double)badPixels / pixels : 0.0;
+    }
+};
+
+// per-band partial sums of the pixel pass
+struct ImageDiffBand
+{
+    size_t badPixels = 0;
+    int maxDiff = 0;
+    uint64_t squaredError = 0;
+};
+
+// largest channel difference of one pixel, alpha excluded
+inline int pixelDiff(const uint8_t* a, const uint8_t* b)
+{
+    int d0 = std::abs((int)a[0] - (int)b[0]);
+    int d1 = std::abs((int)a[1] - (int)b[1]);
+    int d2 = std::abs((int)a[2] - (int)b[2]);
+    return std::max(d0, std::max(d1, d2));
+}
+
+// one row segment of the pixel pass
+// ------------------------------------------------------------------------
+inline void diffRow(const uint8_t* a, const uint8_t* b, int width, int tolerance, ImageDiffBand& band)
+{
+    int x = 0;
+#ifdef IMAGE_IO_SSE2
+    const __m128i colorMask = _mm_set1_epi32(0x00FFFFFF);
+    const __m128i limit = _mm_set1_epi32(tolerance);
+    const __m128i zero = _mm_setzero_si128();
+    __m128i maxLanes = zero;
+    // squared errors stay below 2^31 per lane for 1024 pixels, then go to 64 bits
+    while (x + 4 <= width)
+    {
+        int end = std::min(width, x + 1024) & ~3;
+        if (end <= x)
+            break;
+        __m128i squares = zero;
+        for (; x < end; x += 4)
+        {
+            __m128i pa = _mm_loadu_si128((const __m128i*)(a + x * 4));
+            __m128i pb = _mm_loadu_si128((const __m128i*)(b + x * 4));
+            __m128i d = _mm_and_si128(_mm_or_si128(_mm_subs_epu8(pa, pb), _mm_subs_epu8(pb, pa)), colorMask);
+
+            // channel maximum in the low byte of each pixel
+            __m128i m = _mm_max_epu8(d, _mm_srli_epi32(d, 8));
+            m = _mm_max_epu8(m, _mm_srli_epi32(m, 16));
+            m = _mm_and_si128(m, _mm_set1_epi32(0xFF));
+            maxLanes = _mm_max_epi16(maxLanes, m);
+            int bad = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(m, limit)));
+            band.badPixels += (bad & 1) + ((bad >> 1) & 1) + ((bad >> 2) & 1) + ((bad >> 3) & 1);
+
+            __m128i lo = _mm_unpacklo_epi8(d, zero);
+            __m128i hi = _mm_unpackhi_epi8(d, zero);
+            squares = _mm_add_epi32(squares, _mm_add_epi32(_mm_madd_epi16(lo, lo), _mm_madd_epi16(hi, hi)));
+        }
+        uint32_t lanes[4];
+        _mm_storeu_si128((__m128i*)lanes, squares);
+        band.squaredError += (uint64_t)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    }
+    int16_t maxima[8];
+    _mm_storeu_si128((__m128i*)maxima, maxLanes);
+    for (int i = 0; i < 8; i++)
+        band.maxDiff = std::max(band.maxDiff, (int)maxima[i]);
+#endif
+    for (; x < width; x++)
+    {
+        const uint8_t* pa = a + x * 4;
+        const uint8_t* pb = b + x * 4;
+        int d = pixelDiff(pa, pb);
+        band.maxDiff = std::max(band.maxDiff, d);
+        if (d > tolerance)
+            band.badPixels++;
+        for (int c = 0; c < 3; c++)
+            band.squaredError += (uint64_t)((int)pa[c] - (int)pb[c]) * ((int)pa[c] - (int)pb[c]);
+    }
+}
+
+// BT.601 luma, as rgbToY without the studio-range offset
+inline int pixelLuma(const uint8_t* p)
+{
+    return (77 * p[0] + 150 * p[1] + 29 * p[2]) >> 8;
+}
+
+// luma sums of one 8x8 block: a, b, a*a, b*b, a*b
+// ------------------------------------------------------------------------
+inline void ssimBlockSums(const Image& a, const Image& b, int bx, int by, int64_t sums[5])
+{
+    const int N = IMAGE_DIFF_SSIM_BLOCK;
+#ifdef IMAGE_IO_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i weights = _mm_setr_epi16(77, 150, 29, 0, 77, 150, 29, 0);
+    // luma of 8 pixels as 16-bit lanes
+    auto luma8 = [&](const uint8_t* p) {
+        __m128i p0 = _mm_loadu_si128((const __m128i*)p);
+        __m128i p1 = _mm_loadu_si128((const __m128i*)(p + 16));
+        __m128 m0 = _mm_castsi128_ps(_mm_madd_epi16(_mm_unpacklo_epi8(p0, zero), weights));
+        __m128 m1 = _mm_castsi128_ps(_mm_madd_epi16(_mm_unpackhi_epi8(p0, zero), weights));
+        __m128 m2 = _mm_castsi128_ps(_mm_madd_epi16(_mm_unpacklo_epi8(p1, zero), weights));
+        __m128 m3 = _mm_castsi128_ps(_mm_madd_epi16(_mm_unpackhi_epi8(p1, zero), weights));
+        // each pixel is two lanes: 77 R + 150 G and 29 B
+        __m128i y0 = _mm_add_epi32(_mm_castps_si128(_mm_shuffle_ps(m0, m1, _MM_SHUFFLE(2, 0, 2, 0))),
+            _mm_castps_si128(_mm_shuffle_ps(m0, m1, _MM_SHUFFLE(3, 1, 3, 1))));
+        __m128i y1 = _mm_add_epi32(_mm_castps_si128(_mm_shuffle_ps(m2, m3, _MM_SHUFFLE(2, 0, 2, 0))),
+            _mm_castps_si128(_mm_shuffle_ps(m2, m3, _MM_SHUFFLE(3, 1, 3, 1))));
+        return _mm_packs_epi32(_mm_srli_epi32(y0, 8), _mm_srli_epi32(y1, 8));
+    };
+    __m128i sa = zero, sb = zero, saa = zero, sbb = zero, sab = zero;
+    for (int y = by; y < by + N; y++)
+    {
+        __m128i la = luma8(a.row(y) + bx * 4);
+        __m128i lb = luma8(b.row(y) + bx * 4);
+        sa = _mm_add_epi16(sa, la);
+        sb = _mm_add_epi16(sb, lb);
+        saa = _mm_add_epi32(saa, _mm_madd_epi16(la, la));
+        sbb = _mm_add_epi32(sbb, _mm_madd_epi16(lb, lb));
+        sab = _mm_add_epi32(sab, _mm_madd_epi16(la, lb));
+    }
+    const __m128i ones = _mm_set1_epi16(1);
+    __m128i lanes[5] = { _mm_madd_epi16(sa, ones), _mm_madd_epi16(sb, ones), saa, sbb, sab };
+    for (int i = 0; i < 5; i++)
+    {
+        int32_t v[4];
+        _mm_storeu_si128((__m128i*)v, lanes[i]);
+        sums[i] = (int64_t)v[0] + v[1] + v[2] + v[3];
+    }
+#else
+    for (int i = 0; i < 5; i++)
+        sums[i] = 0;
+    for (int y = by; y < by + N; y++)
+    {
+        const uint8_t* ra = a.row(y) + bx * 4;
+        const uint8_t* rb = b.row(y) + bx * 4;
+        for (int x = 0; x < N; x++)
+        {
+            int la = pixelLuma(ra + x * 4), lb = pixelLuma(rb + x * 4);
+            sums[0] += la;
+            sums[1] += lb;
+            sums[2] += la * la;
+            sums[3] += lb * lb;
+            sums[4] += la * lb;
+        }
+    }
+#endif
+}
+
+// summed SSIM of the complete 8x8 blocks whose top row is blockY
+// ------------------------------------------------------------------------
+inline double ssimBlockRow(const Image& a, const Image& b, int blockY)
+{
+    const double C1 = (0.01 * 255) * (0.01 * 255);
+    const double C2 = (0.03 * 255) * (0.03 * 255);
+    const int N = IMAGE_DIFF_SSIM_BLOCK;
+    const double n = N * N;
+    double total = 0.0;
+    for (int bx = 0; bx + N <= a.width; bx += N)
+    {
+        int64_t sums[5];
+        ssimBlockSums(a, b, bx, blockY, sums);
+        double ma = sums[0] / n, mb = sums[1] / n;
+        double va = sums[2] / n - ma * ma, vb = sums[3] / n - mb * mb, cov = sums[4] / n - ma * mb;
+        total += ((2.0 * ma * mb + C1) * (2.0 * cov + C2)) / ((ma * ma + mb * mb + C1) * (va + vb + C2));
+    }
+    return total;
+}
+
+// compares actual against expected; a NULL pool runs every band on the calling thread
+// ------------------------------------------------------------------------
+inline ImageDiffResult diffImages(const Image& expected, const Image& actual, const ImageDiffOptions& options = ImageDiffOptions(),
+    WorkerPool* pool = NULL)
+{
+    ImageDiffResult result;
+    result.sizeMatches = expected.width == actual.width && expected.height == actual.height;
+    if (!result.sizeMatches || expected.width <= 0 || expected.height <= 0)
+        return result;
+    int width = expected.width, height = expected.height;
+    result.pixels = (size_t)width * height;
+
+    size_t bandCount = (height + IMAGE_DIFF_BAND_ROWS - 1) / IMAGE_DIFF_BAND_ROWS;
+    std::vector<ImageDiffBand> bands(bandCount);
+    auto pixelPass = [&](size_t i) {
+        int y0 = (int)i * IMAGE_DIFF_BAND_ROWS, y1 = std::min(height, y0 + IMAGE_DIFF_BAND_ROWS);
+        for (int y = y0; y < y1; y++)
+            diffRow(expected.row(y), actual.row(y), width, options.tolerance, bands[i]);
+    };
+    if (pool)
+        pool->parallelFor(bandCount, pixelPass);
+    else
+        for (size_t i = 0; i < bandCount; i++)
+            pixelPass(i);
+
+    uint64_t squaredError = 0;
+    for (size_t i = 0; i < bandCount; i++)
+    {
+        result.badPixels += bands[i].badPixels;
+        result.maxDiff = std::max(result.maxDiff, bands[i].maxDiff);
+        squaredError += bands[i].squaredError;
+    }
+
+    // identical images need no structural pass
+    if (squaredError == 0)
+    {
+        result.psnr = std::numeric_limits<double>::infinity();
+        result.ssim = 1.0;
+    }
+    else
+    {
+        double mse = (double)squaredError / (3.0 * result.pixels);
+        result.psnr = 10.0 * std::log10(255.0 * 255.0 / mse);
+
+        int blockRows = height / IMAGE_DIFF_SSIM_BLOCK, blockColumns = width / IMAGE_DIFF_SSIM_BLOCK;
+        std::vector<double> sums(blockRows, 0.0);
+        auto structuralPass = [&](size_t i) { sums[i] = ssimBlockRow(expected, actual, (int)i * IMAGE_DIFF_SSIM_BLOCK); };
+        if (pool)
+            pool->parallelFor(sums.size(), structuralPass);
+        else
+            for (size_t i = 0; i < sums.size(); i++)
+                structuralPass(i);
+        double total = 0.0;
+        for (size_t i = 0; i < sums.size(); i++)
+            total += sums[i];
+        size_t blocks = (size_t)blockRows * blockColumns;
+        // images smaller than one block fall back on the pixel counts alone
+        result.ssim = blocks > 0 ? total / blocks : 1.0;
+    }
+
+    result.passed = result.badFraction() <= options.maxBadFraction && result.ssim >= options.minSSIM;
+    return result;
+}
+
+// a picture of where two images differ: the expected image as dim gray, pixels
+// within the tolerance tinted blue, pixels beyond it from red to yellow by how far off they are
+// ------------------------------------------------------------------------
+inline void diffHeatMap(const Image& expected, const Image& actual, int tolerance, Image& heatMap)
+{
+    heatMap.resize(expected.width, expected.height);
+    if (expected.width != actual.width || expected.height != actual.height)
+    {
+        heatMap.rgba.assign(heatMap.rgba.size(), 255);
+        return;
+    }
+    for (int y = 0; y < expected.height; y++)
+    {
+        const uint8_t* a = expected.row(y);
+        const uint8_t* b = actual.row(y);
+        uint8_t* out = heatMap.row(y);
+        for (int x = 0; x < expected.width; x++, a += 4, b += 4, out += 4)
+        {
+            int d = pixelDiff(a, b);
+            uint8_t gray = (uint8_t)(pixelLuma(a) / 4);
+            if (d == 0)
+            {
+                out[0] = out[1] = out[2] = gray;
+            }
+            else if (d <= tolerance)
+            {
+                out[0] = out[1] = gray;
+                out[2] = (uint8_t)std::min(255, gray + 96);
+            }
+            else
+            {
+                out[0] = 255;
+                out[1] = (uint8_t)(255 * (d - tolerance) / (255 - tolerance > 0 ? 255 - tolerance : 1));
+                out[2] = 0;
+            }
+            out[3] = 255;
+        }
+    }
+}
+
+#endif
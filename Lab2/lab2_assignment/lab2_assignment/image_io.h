@@ -0,0 +1,388 @@
+#pragma once
+//
+//  image_io.h
+//  3D Object Drawing
+//
+//  RGBA8 images and the file formats frames are saved in: binary PPM (which
+//  can also be read back), PNG
+//  (deflate "stored" blocks, so no zlib is needed; files are uncompressed) and
+//  raw YUV4MPEG2 video. RGB to 4:2:0 YUV uses BT.601 studio-range integer
+//  coefficients and runs 16 pixels at a time with SSE2 where the compiler
+//  targets it, with a scalar loop for the rest.
+//
+
+#ifndef IMAGE_IO_H
+#define IMAGE_IO_H
+
+#include <string>
+#include <vector>
+#include <array>
+#include <fstream>
+#include <iostream>
+#include <cstring>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define IMAGE_IO_SSE2 1
+#include <emmintrin.h>
+#endif
+
+// top row first, 4 bytes per pixel
+struct Image
+{
+    int width = 0;
+    int height = 0;
+    std::vector<uint8_t> rgba;
+
+    void resize(int w, int h)
+    {
+        width = w;
+        height = h;
+        rgba.resize((size_t)w * h * 4);
+    }
+    const uint8_t* row(int y) const
+    {
+        return &rgba[(size_t)y * width * 4];
+    }
+    uint8_t* row(int y)
+    {
+        return &rgba[(size_t)y * width * 4];
+    }
+};
+
+// ------------------------------------------------------------------------
+inline bool writePPM(const std::string& path, const Image& image)
+{
+    std::ofstream file(path.c_str(), std::ios::binary);
+    file << "P6\n" << image.width << " " << image.height << "\n255\n";
+    std::vector<uint8_t> rgb((size_t)image.width * 3);
+    for (int y = 0; y < image.height; y++)
+    {
+        const uint8_t* src = image.row(y);
+        for (int x = 0; x < image.width; x++)
+        {
+            rgb[x * 3 + 0] = src[x * 4 + 0];
+            rgb[x * 3 + 1] = src[x * 4 + 1];
+            rgb[x * 3 + 2] = src[x * 4 + 2];
+        }
+        file.write((const char*)rgb.data(), rgb.size());
+    }
+    if (!file)
+    {
+        std::cout << "ERROR::IMAGE::NOT_WRITTEN " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// reads a binary 8-bit PPM (P6) as written by writePPM
+// ------------------------------------------------------------------------
+inline bool readPPM(const std::string& path, Image& image)
+{
+    std::ifstream file(path.c_str(), std::ios::binary);
+    std::string magic;
+    int w = 0, h = 0, maxValue = 0;
+    file >> magic;
+    // header fields may be separated by comments
+    auto field = [&file](int& value) {
+        file >> std::ws;
+        while (file.peek() == '#')
+        {
+            std::string comment;
+            std::getline(file, comment);
+            file >> std::ws;
+        }
+        file >> value;
+    };
+    field(w);
+    field(h);
+    field(maxValue);
+    file.get();
+    if (!file || magic != "P6" || w <= 0 || h <= 0 || maxValue != 255)
+    {
+        std::cout << "ERROR::IMAGE::BAD_PPM " << path << std::endl;
+        return false;
+    }
+    image.resize(w, h);
+    std::vector<uint8_t> rgb((size_t)w * 3);
+    for (int y = 0; y < h; y++)
+    {
+        if (!file.read((char*)rgb.data(), rgb.size()))
+        {
+            std::cout << "ERROR::IMAGE::TRUNCATED " << path << std::endl;
+            return false;
+        }
+        uint8_t* dst = image.row(y);
+        for (int x = 0; x < w; x++)
+        {
+            dst[x * 4 + 0] = rgb[x * 3 + 0];
+            dst[x * 4 + 1] = rgb[x * 3 + 1];
+            dst[x * 4 + 2] = rgb[x * 3 + 2];
+            dst[x * 4 + 3] = 255;
+        }
+    }
+    return true;
+}
+
+// lookup table of the PNG CRC-32
+// ------------------------------------------------------------------------
+inline std::array<uint32_t, 256> makeCrcTable()
+{
+    std::array<uint32_t, 256> table;
+    for (uint32_t n = 0; n < 256; n++)
+    {
+        uint32_t c = n;
+        for (int k = 0; k < 8; k++)
+            c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        table[n] = c;
+    }
+    return table;
+}
+
+// CRC-32 of PNG chunks and Adler-32 of the zlib stream; encoders run on several
+// workers at once, so the table is a function-local static, built exactly once
+// ------------------------------------------------------------------------
+inline uint32_t crc32Update(uint32_t crc, const uint8_t* data, size_t size)
+{
+    static const std::array<uint32_t, 256> table = makeCrcTable();
+    crc = ~crc;
+    for (size_t i = 0; i < size; i++)
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+inline uint32_t adler32Update(uint32_t adler, const uint8_t* data, size_t size)
+{
+    uint32_t a = adler & 0xFFFF, b = adler >> 16;
+    while (size > 0)
+    {
+        size_t n = size < 5552 ? size : 5552;       // largest run before the sums can overflow
+        size -= n;
+        for (; n > 0; n--)
+        {
+            a += *data++;
+            b += a;
+        }
+        a %= 65521;
+        b %= 65521;
+    }
+    return (b << 16) | a;
+}
+
+// 8-bit RGB PNG, filter type 0 on every row, the image data in stored deflate blocks
+// ------------------------------------------------------------------------
+inline bool writePNG(const std::string& path, const Image& image)
+{
+    // filtered scanlines: a 0 byte, then RGB
+    size_t stride = (size_t)image.width * 3 + 1;
+    std::vector<uint8_t> raw(stride * image.height);
+    for (int y = 0; y < image.height; y++)
+    {
+        uint8_t* dst = &raw[stride * y];
+        const uint8_t* src = image.row(y);
+        *dst++ = 0;
+        for (int x = 0; x < image.width; x++, dst += 3, src += 4)
+        {
+            dst[0] = src[0];
+            dst[1] = src[1];
+            dst[2] = src[2];
+        }
+    }
+
+    // zlib stream: header, stored blocks of at most 65535 bytes, Adler-32
+    std::vector<uint8_t> idat;
+    idat.reserve(raw.size() + raw.size() / 65535 * 5 + 16);
+    idat.push_back(0x78);
+    idat.push_back(0x01);
+    size_t offset = 0;
+    do
+    {
+        size_t n = raw.size() - offset < 65535 ? raw.size() - offset : 65535;
+        bool last = offset + n == raw.size();
+        idat.push_back(last ? 1 : 0);
+        idat.push_back((uint8_t)(n & 0xFF));
+        idat.push_back((uint8_t)(n >> 8));
+        idat.push_back((uint8_t)(~n & 0xFF));
+        idat.push_back((uint8_t)((~n >> 8) & 0xFF));
+        idat.insert(idat.end(), raw.begin() + offset, raw.begin() + offset + n);
+        offset += n;
+    } while (offset < raw.size());
+    uint32_t adler = adler32Update(1, raw.data(), raw.size());
+    for (int s = 24; s >= 0; s -= 8)
+        idat.push_back((uint8_t)(adler >> s));
+
+    std::ofstream file(path.c_str(), std::ios::binary);
+    static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    file.write((const char*)signature, 8);
+    auto chunk = [&file](const char* type, const uint8_t* data, size_t size) {
+        uint8_t length[4] = { (uint8_t)(size >> 24), (uint8_t)(size >> 16), (uint8_t)(size >> 8), (uint8_t)size };
+        file.write((const char*)length, 4);
+        file.write(type, 4);
+        if (size > 0)
+            file.write((const char*)data, size);
+        uint32_t crc = crc32Update(crc32Update(0, (const uint8_t*)type, 4), data, size);
+        uint8_t crcBytes[4] = { (uint8_t)(crc >> 24), (uint8_t)(crc >> 16), (uint8_t)(crc >> 8), (uint8_t)crc };
+        file.write((const char*)crcBytes, 4);
+    };
+    uint8_t header[13] = {
+        (uint8_t)(image.width >> 24), (uint8_t)(image.width >> 16), (uint8_t)(image.width >> 8), (uint8_t)image.width,
+        (uint8_t)(image.height >> 24), (uint8_t)(image.height >> 16), (uint8_t)(image.height >> 8), (uint8_t)image.height,
+        8, 2, 0, 0, 0   // bit depth, color type RGB, deflate, filter method 0, no interlace
+    };
+    chunk("IHDR", header, sizeof(header));
+    chunk("IDAT", idat.data(), idat.size());
+    chunk("IEND", NULL, 0);
+    if (!file)
+    {
+        std::cout << "ERROR::IMAGE::NOT_WRITTEN " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// BT.601 studio range, 8-bit fixed point
+// ------------------------------------------------------------------------
+inline uint8_t rgbToY(int r, int g, int b)
+{
+    return (uint8_t)(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+}
+inline uint8_t rgbToU(int r, int g, int b)
+{
+    return (uint8_t)(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+}
+inline uint8_t rgbToV(int r, int g, int b)
+{
+    return (uint8_t)(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+}
+
+#ifdef IMAGE_IO_SSE2
+// R, G and B of 8 RGBA pixels as 16-bit lanes
+inline void loadRGB8(const uint8_t* src, __m128i& r, __m128i& g, __m128i& b)
+{
+    const __m128i mask = _mm_set1_epi32(0xFF);
+    __m128i p0 = _mm_loadu_si128((const __m128i*)src);
+    __m128i p1 = _mm_loadu_si128((const __m128i*)(src + 16));
+    r = _mm_packs_epi32(_mm_and_si128(p0, mask), _mm_and_si128(p1, mask));
+    g = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(p0, 8), mask), _mm_and_si128(_mm_srli_epi32(p1, 8), mask));
+    b = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(p0, 16), mask), _mm_and_si128(_mm_srli_epi32(p1, 16), mask));
+}
+// sums of horizontally adjacent pairs of two rows, 8 pixels -> 4 sums in 32-bit lanes
+inline __m128i sum2x2(__m128i top, __m128i bottom)
+{
+    return _mm_madd_epi16(_mm_add_epi16(top, bottom), _mm_set1_epi16(1));
+}
+#endif
+
+// converts an RGBA image with even width and height into I420 planes: Y (width x height), then U and V (half size)
+// ------------------------------------------------------------------------
+inline void rgbaToI420(const Image& image, uint8_t* yPlane, uint8_t* uPlane, uint8_t* vPlane)
+{
+    int w = image.width, h = image.height, cw = w / 2;
+    for (int y = 0; y < h; y += 2)
+    {
+        const uint8_t* top = image.row(y);
+        const uint8_t* bottom = image.row(y + 1);
+        uint8_t* yTop = yPlane + (size_t)y * w;
+        uint8_t* yBottom = yTop + w;
+        uint8_t* u = uPlane + (size_t)(y / 2) * cw;
+        uint8_t* v = vPlane + (size_t)(y / 2) * cw;
+        int x = 0;
+#ifdef IMAGE_IO_SSE2
+        const __m128i cR = _mm_set1_epi16(66), cG = _mm_set1_epi16(129), cB = _mm_set1_epi16(25);
+        const __m128i uR = _mm_set1_epi16(-38), uG = _mm_set1_epi16(-74), uB = _mm_set1_epi16(112);
+        const __m128i vR = _mm_set1_epi16(112), vG = _mm_set1_epi16(-94), vB = _mm_set1_epi16(-18);
+        const __m128i round = _mm_set1_epi16(128), lumaOffset = _mm_set1_epi16(16), two = _mm_set1_epi32(2);
+        for (; x + 16 <= w; x += 16)
+        {
+            __m128i r[4], g[4], b[4];       // top 0-7, top 8-15, bottom 0-7, bottom 8-15
+            loadRGB8(top + x * 4, r[0], g[0], b[0]);
+            loadRGB8(top + x * 4 + 32, r[1], g[1], b[1]);
+            loadRGB8(bottom + x * 4, r[2], g[2], b[2]);
+            loadRGB8(bottom + x * 4 + 32, r[3], g[3], b[3]);
+
+            // luma: the weighted sum stays below 65536, so unsigned 16-bit lanes are enough
+            __m128i luma[4];
+            for (int i = 0; i < 4; i++)
+            {
+                __m128i sum = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(r[i], cR), _mm_mullo_epi16(g[i], cG)),
+                    _mm_add_epi16(_mm_mullo_epi16(b[i], cB), round));
+                luma[i] = _mm_add_epi16(_mm_srli_epi16(sum, 8), lumaOffset);
+            }
+            _mm_storeu_si128((__m128i*)(yTop + x), _mm_packus_epi16(luma[0], luma[1]));
+            _mm_storeu_si128((__m128i*)(yBottom + x), _mm_packus_epi16(luma[2], luma[3]));
+
+            // chroma from the mean of each 2x2 block
+            __m128i ra = _mm_packs_epi32(_mm_srli_epi32(_mm_add_epi32(sum2x2(r[0], r[2]), two), 2), _mm_srli_epi32(_mm_add_epi32(sum2x2(r[1], r[3]), two), 2));
+            __m128i ga = _mm_packs_epi32(_mm_srli_epi32(_mm_add_epi32(sum2x2(g[0], g[2]), two), 2), _mm_srli_epi32(_mm_add_epi32(sum2x2(g[1], g[3]), two), 2));
+            __m128i ba = _mm_packs_epi32(_mm_srli_epi32(_mm_add_epi32(sum2x2(b[0], b[2]), two), 2), _mm_srli_epi32(_mm_add_epi32(sum2x2(b[1], b[3]), two), 2));
+            __m128i us = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(ra, uR), _mm_mullo_epi16(ga, uG)), _mm_add_epi16(_mm_mullo_epi16(ba, uB), round));
+            __m128i vs = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(ra, vR), _mm_mullo_epi16(ga, vG)), _mm_add_epi16(_mm_mullo_epi16(ba, vB), round));
+            __m128i uq = _mm_add_epi16(_mm_srai_epi16(us, 8), round);
+            __m128i vq = _mm_add_epi16(_mm_srai_epi16(vs, 8), round);
+            _mm_storel_epi64((__m128i*)(u + x / 2), _mm_packus_epi16(uq, uq));
+            _mm_storel_epi64((__m128i*)(v + x / 2), _mm_packus_epi16(vq, vq));
+        }
+#endif
+        for (; x < w; x += 2)
+        {
+            const uint8_t* p[4] = { top + x * 4, top + x * 4 + 4, bottom + x * 4, bottom + x * 4 + 4 };
+            yTop[x] = rgbToY(p[0][0], p[0][1], p[0][2]);
+            yTop[x + 1] = rgbToY(p[1][0], p[1][1], p[1][2]);
+            yBottom[x] = rgbToY(p[2][0], p[2][1], p[2][2]);
+            yBottom[x + 1] = rgbToY(p[3][0], p[3][1], p[3][2]);
+            int r = (p[0][0] + p[1][0] + p[2][0] + p[3][0] + 2) >> 2;
+            int g = (p[0][1] + p[1][1] + p[2][1] + p[3][1] + 2) >> 2;
+            int b = (p[0][2] + p[1][2] + p[2][2] + p[3][2] + 2) >> 2;
+            u[x / 2] = rgbToU(r, g, b);
+            v[x / 2] = rgbToV(r, g, b);
+        }
+    }
+}
+
+// raw 4:2:0 video, one "FRAME" after another
+class Y4MWriter
+{
+public:
+    int width = 0, height = 0;
+    size_t frames = 0;
+
+    // ------------------------------------------------------------------------
+    bool open(const std::string& path, int videoWidth, int videoHeight, int fps)
+    {
+        width = videoWidth;
+        height = videoHeight;
+        file.open(path.c_str(), std::ios::binary);
+        file << "YUV4MPEG2 W" << width << " H" << height << " F" << fps << ":1 Ip A1:1 C420mpeg2\n";
+        if (!file)
+        {
+            std::cout << "ERROR::Y4M::NOT_OPENED " << path << std::endl;
+            return false;
+        }
+        return true;
+    }
+    // planes as written by rgbaToI420, back to back
+    // ------------------------------------------------------------------------
+    void append(const std::vector<uint8_t>& i420)
+    {
+        file << "FRAME\n";
+        file.write((const char*)i420.data(), i420.size());
+        frames++;
+    }
+    static size_t frameBytes(int w, int h)
+    {
+        return (size_t)w * h + 2 * (size_t)(w / 2) * (h / 2);
+    }
+    bool close()
+    {
+        if (!file.is_open())
+            return true;
+        file.close();
+        return !file.fail();
+    }
+
+private:
+    std::ofstream file;
+};
+
+#endif
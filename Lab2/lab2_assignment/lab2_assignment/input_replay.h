@@ -0,0 +1,252 @@
+#pragma once
+//
+//  input_replay.h
+//  3D Object Drawing
+//
+//  Recording and replay of the key stream for reproducible runs. While
+//  recording, every key and scroll event from the GLFW callbacks is stored with the index
+//  of the simulation step that consumes it, the frame it arrived in and its
+//  time, and the tape is written to a compact binary file on exit. A replay
+//  ignores the live keyboard and wheel and feeds the stored events to input() right
+//  before their step, at the recorded simulation rate, while frames advance by
+//  a fixed INPUT_REPLAY_FRAME_SECONDS; two replays of one tape therefore
+//  simulate and draw exactly the same frames.
+//
+//  File layout (little-endian): InputTapeHeader, then eventCount InputTapeEvent.
+//
+
+#ifndef INPUT_REPLAY_H
+#define INPUT_REPLAY_H
+
+#include <GLFW/glfw3.h>
+
+#include "input_state.h"
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <cstring>
+#include <cstddef>
+#include <cstdint>
+
+// simulated time per frame of a replay
+const double INPUT_REPLAY_FRAME_SECONDS = 1.0 / 60.0;
+
+const uint32_t INPUT_TAPE_MAGIC = 0x54504E49;       // "INPT"
+const uint32_t INPUT_TAPE_VERSION = 2;
+// key value of a recorded InputState::clear() (the window lost focus)
+const int16_t INPUT_TAPE_CLEAR = -1;
+// key value of a scroll-wheel event; its offset is in value
+const int16_t INPUT_TAPE_SCROLL = -2;
+
+struct InputTapeHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t eventCount;
+    uint32_t steps;             // simulation steps the recording ran
+    uint32_t frames;
+    uint32_t reserved;
+    double simulationHz;
+};
+
+struct InputTapeEvent
+{
+    uint32_t step;              // consumed by this simulation step
+    uint32_t frame;             // arrived during this frame
+    float seconds;              // since recording started
+    int16_t key;                // GLFW key, INPUT_TAPE_CLEAR or INPUT_TAPE_SCROLL
+    uint8_t action;             // GLFW_PRESS or GLFW_RELEASE
+    uint8_t reserved;
+    float value;                // vertical scroll offset of an INPUT_TAPE_SCROLL event, else 0
+};
+
+static_assert(sizeof(InputTapeHeader) == 32, "InputTapeHeader layout");
+static_assert(sizeof(InputTapeEvent) == 20, "InputTapeEvent layout");
+
+enum InputTapeMode
+{
+    TAPE_OFF,
+    TAPE_RECORDING,
+    TAPE_REPLAYING
+};
+
+class InputTape
+{
+public:
+    InputTapeMode mode = TAPE_OFF;
+
+    // ------------------------------------------------------------------------
+    bool record(const std::string& tapePath, double simulationHz)
+    {
+        path = tapePath;
+        events.clear();
+        std::memset(&header, 0, sizeof(header));
+        header.magic = INPUT_TAPE_MAGIC;
+        header.version = INPUT_TAPE_VERSION;
+        header.simulationHz = simulationHz;
+        step = frame = 0;
+        start = glfwGetTime();
+        mode = TAPE_RECORDING;
+        return true;
+    }
+    // ------------------------------------------------------------------------
+    bool replay(const std::string& tapePath)
+    {
+        path = tapePath;
+        std::ifstream file(tapePath.c_str(), std::ios::binary);
+        if (!file.read((char*)&header, sizeof(header)) || header.magic != INPUT_TAPE_MAGIC ||
+            header.version != INPUT_TAPE_VERSION || !(header.simulationHz > 0.0))
+        {
+            std::cout << "ERROR::INPUT_TAPE::BAD_FILE " << tapePath << std::endl;
+            return false;
+        }
+        events.resize(header.eventCount);
+        if (header.eventCount > 0 && !file.read((char*)events.data(), sizeof(InputTapeEvent) * events.size()))
+        {
+            std::cout << "ERROR::INPUT_TAPE::TRUNCATED " << tapePath << std::endl;
+            return false;
+        }
+        step = frame = 0;
+        next = 0;
+        mode = TAPE_REPLAYING;
+        std::cout << "Replaying " << tapePath << ": " << header.eventCount << " input events over " << header.steps
+            << " steps at " << header.simulationHz << " Hz" << std::endl;
+        return true;
+    }
+    // the simulation rate the tape was recorded at
+    double simulationHz() const
+    {
+        return header.simulationHz;
+    }
+    // ------------------------------------------------------------------------
+    void beginFrame()
+    {
+        frame++;
+    }
+    // replay: hands the events of the coming step to state
+    // ------------------------------------------------------------------------
+    void beginStep(InputState& state)
+    {
+        if (mode != TAPE_REPLAYING)
+            return;
+        for (; next < events.size() && events[next].step <= step; next++)
+        {
+            if (events[next].key == INPUT_TAPE_CLEAR)
+                state.clear();
+            else if (events[next].key == INPUT_TAPE_SCROLL)
+                state.onScroll(events[next].value);
+            else
+                state.onKey(events[next].key, events[next].action);
+        }
+    }
+    void endStep()
+    {
+        step++;
+    }
+    // replay: every recorded step has run
+    bool finished() const
+    {
+        return mode == TAPE_REPLAYING && step >= header.steps;
+    }
+    // a live key, focus or scroll event; recorded, or dropped during a replay
+    // ------------------------------------------------------------------------
+    void onKey(int key, int action)
+    {
+        if (mode == TAPE_REPLAYING)
+            return;
+        if (mode == TAPE_RECORDING && key >= 0 && key <= GLFW_KEY_LAST && action != GLFW_REPEAT)
+            store((int16_t)key, (uint8_t)action);
+        input().onKey(key, action);
+    }
+    void onFocus(int focused)
+    {
+        if (mode == TAPE_REPLAYING || focused)
+            return;
+        if (mode == TAPE_RECORDING)
+            store(INPUT_TAPE_CLEAR, 0);
+        input().clear();
+    }
+    void onScroll(float yoffset)
+    {
+        if (mode == TAPE_REPLAYING)
+            return;
+        if (mode == TAPE_RECORDING)
+            store(INPUT_TAPE_SCROLL, 0, yoffset);
+        input().onScroll(yoffset);
+    }
+    // recording: writes the tape
+    // ------------------------------------------------------------------------
+    bool close()
+    {
+        if (mode != TAPE_RECORDING)
+            return true;
+        mode = TAPE_OFF;
+        header.eventCount = (uint32_t)events.size();
+        header.steps = step;
+        header.frames = frame;
+        std::ofstream file(path.c_str(), std::ios::binary);
+        file.write((const char*)&header, sizeof(header));
+        if (!events.empty())
+            file.write((const char*)events.data(), sizeof(InputTapeEvent) * events.size());
+        if (!file)
+        {
+            std::cout << "ERROR::INPUT_TAPE::NOT_WRITTEN " << path << std::endl;
+            return false;
+        }
+        std::cout << "Recorded " << events.size() << " input events over " << step << " steps and " << frame
+            << " frames to " << path << std::endl;
+        return true;
+    }
+
+private:
+    std::string path;
+    InputTapeHeader header = {};
+    std::vector<InputTapeEvent> events;
+    uint32_t step = 0;
+    uint32_t frame = 0;
+    size_t next = 0;
+    double start = 0.0;
+
+    void store(int16_t key, uint8_t action, float value = 0.0f)
+    {
+        InputTapeEvent event;
+        event.step = step;
+        event.frame = frame;
+        event.seconds = (float)(glfwGetTime() - start);
+        event.key = key;
+        event.action = action;
+        event.reserved = 0;
+        event.value = value;
+        events.push_back(event);
+    }
+};
+
+// one tape per process, like input()
+// ------------------------------------------------------------------------
+inline InputTape& inputTape()
+{
+    static InputTape tape;
+    return tape;
+}
+
+inline void tapeKeyCallback(GLFWwindow* window, int key, int scancode, int action, int mods)
+{
+    inputTape().onKey(key, action);
+}
+
+inline void tapeFocusCallback(GLFWwindow* window, int focused)
+{
+    inputTape().onFocus(focused);
+}
+
+// like attachInput(), with the events passing through inputTape() first
+// ------------------------------------------------------------------------
+inline void attachInputTape(GLFWwindow* window)
+{
+    glfwSetKeyCallback(window, tapeKeyCallback);
+    glfwSetWindowFocusCallback(window, tapeFocusCallback);
+}
+
+#endif
@@ -0,0 +1,199 @@
+#pragma once
+//
+//  input_state.h
+//  3D Object Drawing
+//
+//  Keyboard state fed by the GLFW key callback instead of polling every key
+//  each frame. Keys held down live in one bitset; presses and releases since
+//  the last simulation step live in two more, so a tap shorter than a frame is
+//  still seen once. Key bindings are rows of an ActionTable: a step walks the
+//  table and runs the handlers whose trigger fired, and does nothing at all
+//  when no key is down and nothing changed. Scroll-wheel offsets add up in the
+//  same way until a step takes them.
+//
+
+#ifndef INPUT_STATE_H
+#define INPUT_STATE_H
+
+#include <GLFW/glfw3.h>
+
+#include "profiler.h"
+
+#include <bitset>
+#include <vector>
+#include <iostream>
+#include <cstddef>
+
+enum KeyTrigger
+{
+    KEY_HELD,       // every step while the key is down
+    KEY_PRESSED,    // the first step after the key went down
+    KEY_RELEASED    // the first step after the key went up
+};
+
+class InputState
+{
+public:
+    size_t keyEvents = 0;
+
+    // ------------------------------------------------------------------------
+    void onKey(int key, int action)
+    {
+        if (key < 0 || key > GLFW_KEY_LAST || action == GLFW_REPEAT)
+            return;
+        keyEvents++;
+        if (action == GLFW_PRESS)
+        {
+            down.set(key);
+            pressedEvents.set(key);
+        }
+        else
+        {
+            down.reset(key);
+            releasedEvents.set(key);
+        }
+    }
+    void onScroll(float yoffset)
+    {
+        scrolled += yoffset;
+    }
+    // ------------------------------------------------------------------------
+    bool held(int key) const
+    {
+        return down.test(key);
+    }
+    bool pressed(int key) const
+    {
+        return pressedEvents.test(key);
+    }
+    bool released(int key) const
+    {
+        return releasedEvents.test(key);
+    }
+    bool triggered(int key, KeyTrigger trigger) const
+    {
+        switch (trigger)
+        {
+        case KEY_PRESSED: return pressedEvents.test(key);
+        case KEY_RELEASED: return releasedEvents.test(key);
+        default: return down.test(key);
+        }
+    }
+    // true when no key is down and no edge is waiting to be consumed
+    bool idle() const
+    {
+        return down.none() && pressedEvents.none() && releasedEvents.none();
+    }
+    // the wheel's vertical offset since the last call
+    float takeScroll()
+    {
+        float offset = scrolled;
+        scrolled = 0.0f;
+        return offset;
+    }
+    // edges are consumed by the step that saw them
+    // ------------------------------------------------------------------------
+    void endStep()
+    {
+        pressedEvents.reset();
+        releasedEvents.reset();
+    }
+    // forget every key, e.g. when the window loses focus
+    void clear()
+    {
+        down.reset();
+        endStep();
+    }
+
+private:
+    std::bitset<GLFW_KEY_LAST + 1> down;
+    std::bitset<GLFW_KEY_LAST + 1> pressedEvents;
+    std::bitset<GLFW_KEY_LAST + 1> releasedEvents;
+    float scrolled = 0.0f;
+};
+
+// one keyboard per process, written by the GLFW callback on the main thread
+// ------------------------------------------------------------------------
+inline InputState& input()
+{
+    static InputState state;
+    return state;
+}
+
+inline void inputKeyCallback(GLFWwindow* window, int key, int scancode, int action, int mods)
+{
+    input().onKey(key, action);
+}
+
+inline void inputFocusCallback(GLFWwindow* window, int focused)
+{
+    if (!focused)
+        input().clear();
+}
+
+// routes key events to input(); replaces any key and focus callbacks already set on window
+// ------------------------------------------------------------------------
+inline void attachInput(GLFWwindow* window)
+{
+    glfwSetKeyCallback(window, inputKeyCallback);
+    glfwSetWindowFocusCallback(window, inputFocusCallback);
+}
+
+// runs once per step with the window and the step length in seconds
+typedef void (*ActionHandler)(GLFWwindow* window, float stepSeconds);
+
+struct KeyAction
+{
+    int key;
+    KeyTrigger trigger;
+    ActionHandler run;
+};
+
+class ActionTable
+{
+public:
+    size_t steps = 0;
+    size_t idleSteps = 0;
+    size_t actionsRun = 0;
+
+    // ------------------------------------------------------------------------
+    void bind(int key, KeyTrigger trigger, ActionHandler run)
+    {
+        KeyAction action = { key, trigger, run };
+        actions.push_back(action);
+    }
+    // runs every action whose trigger fired, in binding order, then consumes the edges
+    // ------------------------------------------------------------------------
+    void dispatch(InputState& state, GLFWwindow* window, float stepSeconds)
+    {
+        PROFILE_ZONE("ActionTable::dispatch");
+        steps++;
+        if (state.idle())
+        {
+            idleSteps++;
+            return;
+        }
+        for (size_t i = 0; i < actions.size(); i++)
+            if (state.triggered(actions[i].key, actions[i].trigger))
+            {
+                actions[i].run(window, stepSeconds);
+                actionsRun++;
+            }
+        state.endStep();
+    }
+    size_t size() const
+    {
+        return actions.size();
+    }
+    // ------------------------------------------------------------------------
+    void printStats(const InputState& state) const
+    {
+        std::cout << "Input: " << actions.size() << " bindings, " << state.keyEvents << " key events, " << actionsRun
+            << " actions run over " << steps << " steps (" << idleSteps << " idle)" << std::endl;
+    }
+
+private:
+    std::vector<KeyAction> actions;
+};
+
+#endif
@@ -0,0 +1,22 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aColor;
+layout (location = 2) in mat4 aModel;
+layout (location = 6) in vec4 aInstanceColor;
+
+out vec4 color;
+
+layout (std140) uniform FrameData
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 cameraPosition;
+    float time;
+};
+
+void main()
+{
+    gl_Position = viewProjection * aModel * vec4(aPos, 1.0f);
+    color = aInstanceColor;
+}
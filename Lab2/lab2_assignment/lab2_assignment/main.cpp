@@ -14,28 +14,40 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include "gl_state_cache.h"
 #include "shader.h"
 #include "basic_camera.h"
+#include "mesh_cache.h"
+#include "frame_uniforms.h"
+#include "cube_renderer.h"
+#include "static_batch.h"
+#include "draw_list.h"
+#include "occlusion.h"
+#include "transform_hierarchy.h"
+#include "fixed_timestep.h"
+#include "input_state.h"
+#include "input_replay.h"
+#include "scene_file.h"
+#include "scene_generator.h"
+#include "headless.h"
+#include "profiler.h"
+#include "gl_trace.h"
+#include "frame_capture.h"
+#include "golden.h"
+#include "soft_raster.h"
+#include "benchmarks.h"
 
 #include <iostream>
 #include <vector>
 #include <cmath>
+#include <cstdlib>
 
 using namespace std;
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void mouse_callback(GLFWwindow* window, double xpos, double ypos);
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
-void processInput(GLFWwindow* window);
-
-// draw object functions
-void drawCube(Shader shaderProgram, unsigned int VAO, glm::mat4 parentTrans,
-    float posX = 0.0f, float posY = 0.0f, float posZ = 0.0f,
-    float rotX = 0.0f, float rotY = 0.0f, float rotZ = 0.0f,
-    float scX = 1.0f, float scY = 1.0f, float scZ = 1.0f,
-    glm::vec4 color = glm::vec4(0.0f, 0.0f, 0.0f, 0.0f)); // Default color is green
-
-void generateCylinderVertices(std::vector<float>& vertices, std::vector<unsigned int>& indices, int segments, float height, float radius);
+void bindActions(ActionTable& actions);
 
 
 
@@ -68,14 +80,162 @@ float lastFrame = 0.0f;
 float fanRotateAngle_Y = 0.0f;
 bool isFanRotating = true;
 
-int main()
+// everything the fixed-rate simulation advances; frames render a blend of the last two steps
+struct SimulationState
+{
+    glm::vec3 translate;
+    glm::vec3 rotate;
+    float fanAngle;
+    glm::vec3 cameraPosition;
+    float cameraYaw, cameraPitch, cameraRoll;
+};
+SimulationState captureSimulationState();
+SimulationState interpolateSimulationState(const SimulationState& previous, const SimulationState& current, float alpha);
+void simulate(float stepSeconds);
+
+// a frame of the golden-image suite: a point on the headless camera path and the animated state
+struct GoldenPose
 {
+    const char* name;
+    float pathSeconds;
+    float fanAngle;
+    glm::vec3 translate;
+    glm::vec3 rotate;
+};
+const GoldenPose GOLDEN_POSES[] = {
+    { "orbit_0", 0.0f, 0.0f, glm::vec3(0.0f), glm::vec3(0.0f) },
+    { "orbit_90", 2.5f, 0.0f, glm::vec3(0.0f), glm::vec3(0.0f) },
+    { "orbit_180", 5.0f, 0.0f, glm::vec3(0.0f), glm::vec3(0.0f) },
+    { "orbit_270", 7.5f, 0.0f, glm::vec3(0.0f), glm::vec3(0.0f) },
+    { "fan_spun", 1.25f, 45.0f, glm::vec3(0.0f), glm::vec3(0.0f) },
+    { "room_moved", 0.0f, 0.0f, glm::vec3(0.5f, 0.2f, -0.5f), glm::vec3(0.0f) },
+    { "room_rotated", 0.0f, 0.0f, glm::vec3(0.0f), glm::vec3(0.0f, 30.0f, 0.0f) },
+    { "room_tilted", 2.5f, 120.0f, glm::vec3(0.0f), glm::vec3(10.0f, 0.0f, 5.0f) },
+};
+const int GOLDEN_POSE_COUNT = sizeof(GOLDEN_POSES) / sizeof(GOLDEN_POSES[0]);
+
+int main(int argc, char** argv)
+{
+    // "--compile-scene <text> <binary>" compiles a scene offline, without opening a window
+    if (argc > 3 && std::string(argv[1]) == "--compile-scene")
+        return compileScene(argv[2], argv[3]) ? 0 : -1;
+
+    // "--generate-scene <template> <columns>x<rows> <binary> [seed]" tiles a room into a stress scene
+    if (argc > 4 && std::string(argv[1]) == "--generate-scene")
+    {
+        RoomGridOptions grid;
+        if (argc > 5)
+            grid.seed = (unsigned int)atoi(argv[5]);
+        return parseGridSize(argv[3], grid) && generateRoomGridFile(argv[2], grid, argv[4]) ? 0 : -1;
+    }
+
+    // "--sim-rate <hz>" sets the simulation rate; "--vsync" / "--no-vsync" choose how rendering is paced;
+    // "--scene <path>" loads another scene (text or compiled); "--rooms <columns>x<rows>" [--seed <n>]
+    // renders a grid of copies of that scene instead; "--headless" [--frames <n>] [--report <path>] [--egl]
+    // renders that many frames offscreen along a fixed camera path and reports what they cost;
+    // "--trace <path>" writes the profiling zones of the run as a Chrome trace on exit; "--gl-trace" counts
+    // GL calls per entry point, "--gl-trace-timing" also times them, "--gl-trace-log <path>" logs the first frames;
+    // "--record <path>" saves the key stream of the run, "--replay <path>" plays one back instead of the keyboard;
+    // "--capture <ppm|png|y4m> <path>" saves every frame, as numbered images or one video;
+    // "--golden <dir>" [--golden-update] renders fixed poses headlessly and compares them with reference images;
+    // "--software" [--threads <n>] renders headless frames with the CPU rasterizer instead of GL draws
+    FixedTimestep timestep;
+    double simulationHz = DEFAULT_SIMULATION_HZ;
+    std::string scenePath = "room.scene";
+    RoomGridOptions roomGrid;
+    bool generateRooms = false;
+    int swapInterval = -1;
+    bool headless = false;
+    bool useEGL = false;
+    int headlessFrames = DEFAULT_HEADLESS_FRAMES;
+    std::string reportPath;
+    std::string tracePath;
+    bool traceGL = false, timeGL = false;
+    std::string glLogPath;
+    std::string recordPath, replayPath;
+    CaptureFormat captureFormat = CAPTURE_PNG;
+    std::string capturePath;
+    std::string goldenDir;
+    bool goldenUpdate = false;
+    bool software = false;
+    unsigned int softwareThreads = 0;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--sim-rate" && i + 1 < argc)
+            simulationHz = atof(argv[++i]);
+        else if (arg == "--scene" && i + 1 < argc)
+            scenePath = argv[++i];
+        else if (arg == "--rooms" && i + 1 < argc)
+            generateRooms = parseGridSize(argv[++i], roomGrid);
+        else if (arg == "--seed" && i + 1 < argc)
+            roomGrid.seed = (unsigned int)atoi(argv[++i]);
+        else if (arg == "--vsync")
+            swapInterval = 1;
+        else if (arg == "--no-vsync")
+            swapInterval = 0;
+        else if (arg == "--headless")
+            headless = true;
+        else if (arg == "--frames" && i + 1 < argc)
+            headlessFrames = atoi(argv[++i]);
+        else if (arg == "--report" && i + 1 < argc)
+            reportPath = argv[++i];
+        else if (arg == "--egl")
+            useEGL = true;
+        else if (arg == "--trace" && i + 1 < argc)
+            tracePath = argv[++i];
+        else if (arg == "--gl-trace")
+            traceGL = true;
+        else if (arg == "--gl-trace-timing")
+            traceGL = timeGL = true;
+        else if (arg == "--gl-trace-log" && i + 1 < argc)
+        {
+            traceGL = true;
+            glLogPath = argv[++i];
+        }
+        else if (arg == "--record" && i + 1 < argc)
+            recordPath = argv[++i];
+        else if (arg == "--replay" && i + 1 < argc)
+            replayPath = argv[++i];
+        else if (arg == "--capture" && i + 2 < argc)
+        {
+            if (!parseCaptureFormat(argv[++i], captureFormat))
+                return -1;
+            capturePath = argv[++i];
+        }
+        else if (arg == "--golden" && i + 1 < argc)
+            goldenDir = argv[++i];
+        else if (arg == "--golden-update")
+            goldenUpdate = true;
+        else if (arg == "--software")
+            software = true;
+        else if (arg == "--threads" && i + 1 < argc)
+            softwareThreads = (unsigned int)atoi(argv[++i]);
+    }
+    bool golden = !goldenDir.empty();
+    if (golden)
+    {
+        headless = true;
+        headlessFrames = GOLDEN_POSE_COUNT;
+    }
+    if (software)
+        headless = true;
+
     // glfw: initialize and configure
     glfwInit();
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
+    // a headless run draws into a framebuffer object, so its window is never shown
+    if (headless)
+    {
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+        swapInterval = 0;
+    }
+    if (useEGL)
+        glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_EGL_CONTEXT_API);
+
 #ifdef __APPLE__
     glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
 #endif
@@ -91,6 +251,7 @@ int main()
     glfwMakeContextCurrent(window);
     glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
     glfwSetScrollCallback(window, scroll_callback);
+    attachInputTape(window);
 
     // glad: load all OpenGL function pointers
     if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
@@ -99,413 +260,610 @@ int main()
         return -1;
     }
 
-    // configure global opengl state
-    glEnable(GL_DEPTH_TEST);
-
-    // build and compile our shader program
-    Shader ourShader("vertexShader.vs", "fragmentShader.fs");
-
-    // set up vertex data (and buffer(s)) and configure vertex attributes for cube
-    float cube_vertices[] = {
-        // positions          // colors
-        0.0f, 0.0f, 0.0f, 0.3f, 0.8f, 0.5f,
-        0.5f, 0.0f, 0.0f, 0.5f, 0.4f, 0.3f,
-        0.5f, 0.5f, 0.0f, 0.2f, 0.7f, 0.3f,
-        0.0f, 0.5f, 0.0f, 0.6f, 0.2f, 0.8f,
-        0.0f, 0.0f, 0.5f, 0.8f, 0.3f, 0.6f,
-        0.5f, 0.0f, 0.5f, 0.4f, 0.4f, 0.8f,
-        0.5f, 0.5f, 0.5f, 0.2f, 0.3f, 0.6f,
-        0.0f, 0.5f, 0.5f, 0.7f, 0.5f, 0.4f
-    };
-    unsigned int cube_indices[] = {
-        0, 3, 2,
-        2, 1, 0,
-
-        1, 2, 6,
-        6, 5, 1,
-
-        5, 6, 7,
-        7, 4, 5,
-
-        4, 7, 3,
-        3, 0, 4,
+    if (swapInterval >= 0)
+        glfwSwapInterval(swapInterval);
+    if (traceGL)
+    {
+        if (!glLogPath.empty())
+            glTrace().openLog(glLogPath);
+        installGLTrace(timeGL);
+    }
+    if (!replayPath.empty())
+    {
+        if (!inputTape().replay(replayPath))
+        {
+            glfwTerminate();
+            return -1;
+        }
+        simulationHz = inputTape().simulationHz();
+    }
+    else if (!recordPath.empty())
+        inputTape().record(recordPath, simulationHz);
+    timestep.init(simulationHz);
+    if (generateRooms)
+    {
+        std::string gridPath = scenePath.substr(0, scenePath.rfind('.')) + "_" + std::to_string(roomGrid.columns) + "x" +
+            std::to_string(roomGrid.rows) + ".sceneb";
+        if (!generateRoomGridFile(scenePath.c_str(), roomGrid, gridPath.c_str()))
+        {
+            glfwTerminate();
+            return -1;
+        }
+        scenePath = gridPath;
+    }
 
-        6, 2, 3,
-        3, 7, 6,
+    // keys reach the scene through the action table, fed by the key callback
+    ActionTable actions;
+    bindActions(actions);
 
-        1, 5, 4,
-        4, 0, 1
-    };
+    // configure global opengl state
+    glState().enable(GL_DEPTH_TEST);
 
-    unsigned int VBO, VAO, EBO;
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
-    glGenBuffers(1, &EBO);
+    // build and compile our shader programs
+    Shader ourShader("vertexShader.vs", "fragmentShader.fs");
+    Shader instancedShader("instancedVertexShader.vs", "vertexColorFragmentShader.fs");
+    Shader staticShader("vertexShader.vs", "vertexColorFragmentShader.fs");
+
+    // uniforms set every frame are resolved once up front
+    UniformMat4 staticModel = staticShader.uniform<glm::mat4>("model");
+
+    // camera matrices live in one uniform buffer shared by every program
+    FrameUniformBuffer frameUniforms;
+    frameUniforms.init();
+    ourShader.bindUniformBlock("FrameData", FRAME_UNIFORMS_BINDING);
+    instancedShader.bindUniformBlock("FrameData", FRAME_UNIFORMS_BINDING);
+    staticShader.bindUniformBlock("FrameData", FRAME_UNIFORMS_BINDING);
+
+    // build and upload every primitive once; the render loop only binds them
+    MeshCache meshCache;
+    MeshHandle cubeMesh = meshCache.acquire(PRIMITIVE_CUBE);
+    MeshHandle axesMesh = meshCache.acquire(PRIMITIVE_AXES, 0, 3.0f);
+
+    // moving cubes are collected per frame and drawn with a single instanced call
+    InstancedCubeRenderer cubeRenderer;
+    cubeRenderer.init(meshCache.get(cubeMesh));
+    std::vector<CubeInstance> cubeInstances;
+
+    // benchmark mode: "--bench <name>" runs the benchmark instead of the interactive scene
+    if (argc > 2 && std::string(argv[1]) == "--bench")
+    {
+        BenchContext bench = { window, &ourShader, &instancedShader, &staticShader, &meshCache, cubeMesh, &frameUniforms };
+        bool found = runBenchmark(argv[2], bench);
+        frameUniforms.clear();
+        cubeRenderer.clear();
+        meshCache.clear();
+        glfwTerminate();
+        return found ? 0 : -1;
+    }
 
-    glBindVertexArray(VAO);
+    // the room is described by a scene file: static furniture is merged once into a batch drawn
+    // with the world matrix of its anchor (the room, or each cell of a generated grid), so moving
+    // the room never rebuilds it; occluders and moving parts are nodes of the transform hierarchy.
+    // Scenes have a single root, the room.
+    SceneFile scene;
+    if (!loadScene(scenePath, scene))
+    {
+        frameUniforms.clear();
+        cubeRenderer.clear();
+        meshCache.clear();
+        glfwTerminate();
+        return -1;
+    }
 
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(cube_vertices), cube_vertices, GL_STATIC_DRAW);
+    // one batch per anchor, each drawn and culled on its own, so a grid's rooms are rejected one by one
+    std::vector<StaticBatch> staticBatches;
+    std::vector<NodeHandle> staticAnchors;
+    TransformHierarchy hierarchy;
+    std::vector<NodeHandle> sceneNodes(scene.size(), NO_NODE);
+    // static groups: their transform relative to their anchor, which static primitives below them are
+    // baked in, and the batch they go to (also set on anchors)
+    std::vector<glm::mat4> anchorSpace(scene.size());
+    std::vector<uint32_t> batchIndex(scene.size(), NO_NODE);
+
+    // floor and walls are rasterized every frame into a small depth buffer that hides what lies behind them
+    std::vector<NodeHandle> occluderNodes;
+    std::vector<MeshHandle> occluderMeshes;
+    OcclusionBuffer occlusion;
+    occlusion.init();
+
+    // moving cubes (the fans' rods and blades), drawn instanced from their world matrices
+    std::vector<NodeHandle> movingParts;
+    std::vector<glm::vec4> movingPartColors;
+
+    // fans, each turned by the shared fan angle on top of its own phase
+    std::vector<NodeHandle> spinningNodes;
+    std::vector<glm::vec3> spinningRotations;
+
+    uint32_t roomIndex = scene.find("room");
+    for (uint32_t i = 0; i < scene.size(); i++)
+    {
+        const SceneNode& node = scene.node(i);
+        NodeHandle parent = node.parent == NO_NODE ? NO_NODE : sceneNodes[node.parent];
+        MeshHandle mesh = node.primitive == SCENE_GROUP ? 0 : meshCache.acquire((PrimitiveType)node.primitive, node.segments, node.height, node.radius);
+        glm::vec4 color = node.getColor();
+        if (node.flags & SCENE_STATIC)
+        {
+            bool underAnchor = !(scene.node(node.parent).flags & SCENE_STATIC);
+            if (underAnchor && batchIndex[node.parent] == NO_NODE)
+            {
+                batchIndex[node.parent] = (uint32_t)staticBatches.size();
+                staticBatches.push_back(StaticBatch());
+                staticAnchors.push_back(sceneNodes[node.parent]);
+            }
+            StaticBatch& staticBatch = staticBatches[batchIndex[node.parent]];
+            glm::mat4 baked = underAnchor ? node.localMatrix() : multiplyAffine(anchorSpace[node.parent], node.localMatrix());
+            if (node.primitive == SCENE_GROUP)
+            {
+                anchorSpace[i] = baked;
+                batchIndex[i] = batchIndex[node.parent];
+            }
+            else
+                staticBatch.add(meshCache.get(mesh), baked, (node.flags & SCENE_MESH_COLOR) ? NULL : &color);
+            if (node.primitive != SCENE_GROUP && !(node.flags & SCENE_OCCLUDER))
+                continue;
+        }
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(cube_indices), cube_indices, GL_STATIC_DRAW);
+        sceneNodes[i] = hierarchy.addNode(parent, node.getPosition(), node.getRotation(), node.getScale(), node.getPivot());
+        if (node.flags & SCENE_SPIN)
+        {
+            spinningNodes.push_back(sceneNodes[i]);
+            spinningRotations.push_back(node.getRotation());
+        }
+        if (node.flags & SCENE_OCCLUDER)
+        {
+            occluderNodes.push_back(sceneNodes[i]);
+            occluderMeshes.push_back(mesh);
+        }
+        else if (node.primitive == PRIMITIVE_CUBE)
+        {
+            movingParts.push_back(sceneNodes[i]);
+            movingPartColors.push_back(color);
+        }
+        else if (node.primitive != SCENE_GROUP)
+            std::cout << "WARNING::SCENE::UNSUPPORTED_MOVING_PRIMITIVE " << scene.name(i) << " (only cubes can move)" << std::endl;
+    }
+    for (size_t b = 0; b < staticBatches.size(); b++)
+        staticBatches[b].build();
+    anchorSpace.clear();
+    batchIndex.clear();
 
-    // position attribute
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
+    // the room node carries the user's translation/rotation
+    if (roomIndex == NO_NODE || scene.node(roomIndex).parent != NO_NODE)
+    {
+        std::cout << "ERROR::SCENE::MISSING_NODE " << scenePath << " needs a root node \"room\"" << std::endl;
+        frameUniforms.clear();
+        clearStaticBatches(staticBatches);
+        cubeRenderer.clear();
+        meshCache.clear();
+        glfwTerminate();
+        return -1;
+    }
+    NodeHandle roomNode = sceneNodes[roomIndex];
+    hierarchy.setPosition(roomNode, glm::vec3(translate_X, translate_Y, translate_Z));
+    hierarchy.setRotation(roomNode, glm::vec3(rotateAngle_X, rotateAngle_Y, rotateAngle_Z));
+    std::cout << "Scene " << scenePath << ": " << scene.size() << " nodes, " << scene.bytes() << " bytes, opened in " << scene.openMs << " ms" << std::endl;
+
+    // every draw of a frame is recorded here and submitted in sort-key order
+    DrawList drawList;
+    drawList.setDepthRange(0.1f, 100.0f);
+
+    // GPU time of the frame and of each of its passes; the cylinder is part of the static batch
+    GpuTimer gpuTimer;
+    gpuTimer.init();
+    GpuScope gpuFrame = gpuTimer.scope("frame");
+    GpuScope gpuClear = gpuTimer.scope("clear");
+    GpuScope gpuAxes = gpuTimer.scope("axes");
+    GpuScope gpuStatic = gpuTimer.scope("static");
+    GpuScope gpuFan = gpuTimer.scope("fan");
+    drawList.setGpuTimer(&gpuTimer);
+
+    // headless: frames go to an offscreen target and the camera circles the room's furniture,
+    // one orbit every CAMERA_PATH_SECONDS of simulated time
+    const double CAMERA_PATH_SECONDS = 10.0;
+    OffscreenTarget offscreen;
+    HeadlessReport report;
+    AABB pathBounds = emptyAABB();
+    if (headless)
+    {
+        if (!offscreen.init(SCR_WIDTH, SCR_HEIGHT))
+        {
+            frameUniforms.clear();
+            clearStaticBatches(staticBatches);
+            cubeRenderer.clear();
+            meshCache.clear();
+            glfwTerminate();
+            return -1;
+        }
+        hierarchy.update();
+        for (size_t b = 0; b < staticBatches.size(); b++)
+        {
+            AABB bounds = transformAABB(staticBatches[b].bounds, hierarchy.world(staticAnchors[b]));
+            growAABB(pathBounds, bounds.min);
+            growAABB(pathBounds, bounds.max);
+        }
+    }
 
-    // color attribute
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
+    // software: the same draws go to the CPU rasterizer; the GL context is only used for setup
+    SoftwareRasterizer raster;
+    if (software && !raster.init(offscreen.width, offscreen.height, softwareThreads))
+    {
+        offscreen.clear();
+        frameUniforms.clear();
+        clearStaticBatches(staticBatches);
+        cubeRenderer.clear();
+        meshCache.clear();
+        glfwTerminate();
+        return -1;
+    }
 
+    // golden: one frame per pose, each compared with <dir>/<scene>_<pose>.ppm
+    GoldenSuite goldenSuite;
+    std::string goldenPrefix;
+    if (golden)
+    {
+        goldenSuite.init(goldenDir, goldenUpdate);
+        size_t nameStart = scenePath.find_last_of("/\\");
+        goldenPrefix = scenePath.substr(nameStart == std::string::npos ? 0 : nameStart + 1);
+        goldenPrefix = goldenPrefix.substr(0, goldenPrefix.find('.'));
+        if (generateRooms)
+            goldenPrefix += "_" + std::to_string(roomGrid.columns) + "x" + std::to_string(roomGrid.rows) +
+                "_" + std::to_string(roomGrid.seed);
+        goldenPrefix += "_";
+    }
 
     // render loop
-    while (!glfwWindowShouldClose(window))
+    SimulationState previousState = captureSimulationState();
+    lastFrame = static_cast<float>(glfwGetTime());
+    glTrace().endSetup();
+    size_t frameCount = 0;
+    double loopStart = glfwGetTime();
+    // headless runs and replays advance by fixed frames so every run draws the same frames
+    bool fixedFrames = headless || inputTape().mode == TAPE_REPLAYING;
+    double fixedFrameSeconds = headless ? HEADLESS_FRAME_SECONDS : INPUT_REPLAY_FRAME_SECONDS;
+
+    // frames are read back a few frames late and encoded on worker threads
+    FrameCapture capture;
+    bool capturing = false;
+    if (!capturePath.empty() && software)
+        std::cout << "WARNING::SOFTWARE::NO_CAPTURE frames drawn without GL are not captured" << std::endl;
+    else if (!capturePath.empty())
+    {
+        int captureWidth = offscreen.width, captureHeight = offscreen.height;
+        if (!headless)
+            glfwGetFramebufferSize(window, &captureWidth, &captureHeight);
+        capturing = capture.init(captureWidth, captureHeight, captureFormat, capturePath, (int)(1.0 / fixedFrameSeconds + 0.5));
+    }
+    while (!glfwWindowShouldClose(window) && (!headless || (int)frameCount < headlessFrames))
     {
+        PROFILE_ZONE("frame");
+
         // per-frame time logic
-        float currentFrame = static_cast<float>(glfwGetTime());
-        deltaTime = currentFrame - lastFrame;
+        double frameStart = glfwGetTime();
+        float currentFrame = fixedFrames ? (float)(frameCount * fixedFrameSeconds) : static_cast<float>(frameStart);
+        deltaTime = fixedFrames ? (float)fixedFrameSeconds : currentFrame - lastFrame;
         lastFrame = currentFrame;
-
-        // input
-        processInput(window);
+        frameCount++;
+        inputTape().beginFrame();
+
+        // redundant binds of the previous frame are tallied before counting restarts
+        glState().beginFrame();
+        glTrace().endFrame();
+        gpuTimer.beginFrame();
+        gpuTimer.begin(gpuFrame);
+
+        // input and simulation in fixed steps, however long the frame took
+        int steps = timestep.advance(deltaTime);
+        for (int step = 0; step < steps; step++)
+        {
+            PROFILE_ZONE("simulation step");
+            previousState = captureSimulationState();
+            inputTape().beginStep(input());
+            actions.dispatch(input(), window, timestep.stepSeconds());
+            basic_camera.ProcessMouseScroll(input().takeScroll());
+            simulate(timestep.stepSeconds());
+            inputTape().endStep();
+        }
+        if (inputTape().finished())
+            glfwSetWindowShouldClose(window, true);
+        SimulationState shown = interpolateSimulationState(previousState, captureSimulationState(), timestep.alpha());
+        float pathSeconds = currentFrame;
+        if (golden)
+        {
+            const GoldenPose& pose = GOLDEN_POSES[frameCount - 1];
+            shown.translate = pose.translate;
+            shown.rotate = pose.rotate;
+            shown.fanAngle = pose.fanAngle;
+            pathSeconds = pose.pathSeconds;
+        }
 
         // render
-        glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        gpuTimer.begin(gpuClear);
+        if (software)
+            raster.beginFrame(glm::vec4(0.2f, 0.3f, 0.3f, 1.0f));
+        else
+        {
+            glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        }
+        gpuTimer.end(gpuClear);
 
         // pass projection matrix to shader
         glm::mat4 projection = glm::perspective(glm::radians(basic_camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
-        ourShader.setMat4("projection", projection);
-
-        // camera/view transformation
-        glm::mat4 view = basic_camera.createViewMatrix();
-        ourShader.setMat4("view", view);
-
-        // Draw Axes
-        ourShader.use();
-        glm::mat4 model = glm::mat4(1.0f);
-        ourShader.setMat4("model", model);
-        glDrawArrays(GL_LINES, 0, 6);
-        glBindVertexArray(0);
-
-        std::vector<float> cylinderVertices;
-        std::vector<unsigned int> cylinderIndices;
-        int segments = 36;
-        float height = 0.3f;
-        float radius = 0.05f;
-
-        // Generate cylinder vertices and indices
-        generateCylinderVertices(cylinderVertices, cylinderIndices, segments, height, radius);
-
-        // Create buffers and arrays
-        unsigned int cylinderVAO, cylinderVBO, cylinderEBO;
-        glGenVertexArrays(1, &cylinderVAO);
-        glGenBuffers(1, &cylinderVBO);
-        glGenBuffers(1, &cylinderEBO);
-
-        glBindVertexArray(cylinderVAO);
-
-        glBindBuffer(GL_ARRAY_BUFFER, cylinderVBO);
-        glBufferData(GL_ARRAY_BUFFER, cylinderVertices.size() * sizeof(float), &cylinderVertices[0], GL_STATIC_DRAW);
-
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, cylinderEBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, cylinderIndices.size() * sizeof(unsigned int), &cylinderIndices[0], GL_STATIC_DRAW);
-
-        // position attribute
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
-        glEnableVertexAttribArray(0);
-
-        // color attribute
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
-        glEnableVertexAttribArray(1);
-
-
-
-        glm::mat4 parentTrans = glm::mat4(1.0f);
-
-        // Apply a translation to move the entire table
-        parentTrans = glm::translate(parentTrans, glm::vec3(translate_X, translate_Y, translate_Z));
-
-        // Apply rotation around the X-axis
-        parentTrans = glm::rotate(parentTrans, glm::radians(rotateAngle_X), glm::vec3(1.0f, 0.0f, 0.0f));
-
-        // Apply rotation around the Y-axis
-        parentTrans = glm::rotate(parentTrans, glm::radians(rotateAngle_Y), glm::vec3(0.0f, 1.0f, 0.0f));
-
-        // Apply rotation around the Z-axis
-        parentTrans = glm::rotate(parentTrans, glm::radians(rotateAngle_Z), glm::vec3(0.0f, 0.0f, 1.0f));
-
-
-        // Draw Cube
-        drawCube(ourShader, VAO, parentTrans, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 2.0, 1.0, 1.0, glm::vec4(0.3f, 0.3f, 0.3f, 1.0f));
-
-        // Drawing floor
-        drawCube(ourShader, VAO, parentTrans, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 12.0, 0.05, 12.0, glm::vec4(0.8f, 0.8f, 0.8f, 1.0f));
-
-        // Drawing walls
-        drawCube(ourShader, VAO, parentTrans, -3.0, 1.5, 0.0f, 0.0f, 0.0f, 0.0f, 0.05, 6.0, 12.0, glm::vec4(0.9f, 0.85f, 0.75f, 1.0f)); // wall
-        drawCube(ourShader, VAO, parentTrans, 3.0, 1.5, 0.0f, 0.0f, 0.0f, 0.0f, 0.05, 6.0, 12.0, glm::vec4(0.9f, 0.85f, 0.75f, 1.0f)); // wall
-        drawCube(ourShader, VAO, parentTrans, 0.0f, 1.5, -3.0, 0.0f, 0.0f, 0.0f, 12.0, 6.0, 0.05, glm::vec4(0.9f, 0.85f, 0.75f, 1.0f)); // wall
-        drawCube(ourShader, VAO, parentTrans, 0.0f, 1.5, 4.0, 0.0f, 0.0f, 0.0f, 12.0, 6.0, 0.05, glm::vec4(0.9f, 0.85f, 0.75f, 1.0f)); // wall
-
-        // Drawing Table
-        drawCube(ourShader, VAO, parentTrans, 2.0f, 0.5f, 2.0f, 0.0f, 0.0f, 0.0f, 2.0f, 0.2f, 2.0f, glm::vec4(0.72f, 0.52f, 0.04f, 1.0f)); // wooden surface
-        drawCube(ourShader, VAO, parentTrans, 1.6f, 0.25f, 1.6f, 0.0f, 0.0f, 0.0f, 0.2f, 1.0f, 0.2f, glm::vec4(0.6f, 0.6f, 0.6f, 1.0f)); // metallic leg
-        drawCube(ourShader, VAO, parentTrans, 2.4f, 0.25f, 2.4f, 0.0f, 0.0f, 0.0f, 0.2f, 1.0f, 0.2f, glm::vec4(0.6f, 0.6f, 0.6f, 1.0f)); // metallic leg
-        drawCube(ourShader, VAO, parentTrans, 2.4f, 0.25f, 1.6f, 0.0f, 0.0f, 0.0f, 0.2f, 1.0f, 0.2f, glm::vec4(0.6f, 0.6f, 0.6f, 1.0f)); // metallic leg
-        drawCube(ourShader, VAO, parentTrans, 1.6f, 0.25f, 2.4f, 0.0f, 0.0f, 0.0f, 0.2f, 1.0f, 0.2f, glm::vec4(0.6f, 0.6f, 0.6f, 1.0f)); // metallic leg
-
-        // Drawing Chair
-        drawCube(ourShader, VAO, parentTrans, 1.5f, 0.25f, 2.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.2f, 1.0f, glm::vec4(0.54f, 0.27f, 0.07f, 1.0f)); // wooden seat
-        drawCube(ourShader, VAO, parentTrans, 1.3f, 0.1f, 1.8f, 0.0f, 0.0f, 0.0f, 0.2f, 0.5f, 0.2f, glm::vec4(0.4f, 0.26f, 0.13f, 1.0f)); // darker leg
-        drawCube(ourShader, VAO, parentTrans, 1.65f, 0.1f, 2.15f, 0.0f, 0.0f, 0.0f, 0.2f, 0.5f, 0.2f, glm::vec4(0.4f, 0.26f, 0.13f, 1.0f)); // darker leg
-        drawCube(ourShader, VAO, parentTrans, 1.65f, 0.1f, 1.8f, 0.0f, 0.0f, 0.0f, 0.2f, 0.5f, 0.2f, glm::vec4(0.4f, 0.26f, 0.13f, 1.0f)); // darker leg
-        drawCube(ourShader, VAO, parentTrans, 1.3f, 0.1f, 2.15f, 0.0f, 0.0f, 0.0f, 0.2f, 0.5f, 0.2f, glm::vec4(0.4f, 0.26f, 0.13f, 1.0f)); // darker leg
-        drawCube(ourShader, VAO, parentTrans, 1.30f, 0.4f, 2.0f, 0.0f, 0.0f, 0.0f, 0.1f, 0.8f, 1.0f, glm::vec4(0.9f, 0.75f, 0.55f, 1.0f)); // fabric backrest
-
-        // Drawing DoubleSitSofa 
-        drawCube(ourShader, VAO, parentTrans, -2.0f, 0.25f, 0.0f, 0.0f, 0.0f, 0.0f, 0.99f, 0.1f, 2.99f, glm::vec4(0.0f, 0.39f, 0.3f, 1.0f)); // surface
-        drawCube(ourShader, VAO, parentTrans, -2.25f, 0.25f, 0.0f, 0.0f, 0.0f, 0.0f, 0.1f, 1.5f, 2.99f, glm::vec4(0.0f, 0.39f, 0.3f, 1.0f)); // backrest
-        drawCube(ourShader, VAO, parentTrans, -2.0f, 0.19f, -0.7f, 0.0f, 0.0f, 0.0f, 1.0f, 0.75f, 0.2f, glm::vec4(0.5f, 0.5f, 0.5f, 1.0f)); // leg
-        drawCube(ourShader, VAO, parentTrans, -2.0f, 0.19f, 0.7f, 0.0f, 0.0f, 0.0f, 1.0f, 0.75f, 0.2f, glm::vec4(0.5f, 0.5f, 0.5f, 1.0f)); // leg
-        drawCube(ourShader, VAO, parentTrans, -1.8f, 0.125f, 0.0f, 0.0f, 0.0f, 0.0f, 0.1f, 0.5f, 3.0f, glm::vec4(0.5f, 0.5f, 0.5f, 1.0f)); // leg
-
-        // Drawing SingleSitSofa
-        drawCube(ourShader, VAO, parentTrans, 0.0f, 0.25f, 2.0f, 0.0f, 90.0f, 0.0f, 0.9f, 0.1f, 1.499f, glm::vec4(0.0f, 0.55f, 0.55f, 1.0f)); // surface
-        drawCube(ourShader, VAO, parentTrans, 0.0f, 0.25f, 2.25f, 0.0f, 90.0f, 0.0f, 0.1f, 1.5f, 1.499f, glm::vec4(0.0f, 0.55f, 0.55f, 1.0f)); // backrest
-        drawCube(ourShader, VAO, parentTrans, 0.4f, 0.19f, 2.0f, 0.0f, 90.0f, 0.0f, 1.0f, 0.75f, 0.2f, glm::vec4(0.5f, 0.5f, 0.5f, 1.0f)); // leg
-        drawCube(ourShader, VAO, parentTrans, -0.4f, 0.19f, 2.0f, 0.0f, 90.0f, 0.0f, 1.0f, 0.75f, 0.2f, glm::vec4(0.5f, 0.5f, 0.5f, 1.0f)); // leg
-        drawCube(ourShader, VAO, parentTrans, 0.0f, 0.125f, 1.8f, 0.0f, 90.0f, 0.0f, 0.1f, 0.5f, 1.5f, glm::vec4(0.5f, 0.5f, 0.5f, 1.0f)); // leg
-
-
-        // Drawing TV
-        drawCube(ourShader, VAO, parentTrans, 0.0f, 1.5, -2.99, 0.0f, 0.0f, 0.0f, 3.0, 1.0, 0.05, glm::vec4(0.0f, 0.0f, 0.0f, 1.0f)); // TV
-
-        // Stand
-        drawCube(ourShader, VAO, parentTrans, -1.0f, 0.0f, 2.0f, 0.0f, 0.0f, 0.0f, 0.01f, 3.5f, 0.01f, glm::vec4(0.5f, 0.5f, 0.5f, 1.0f)); // long stand
-        drawCube(ourShader, VAO, parentTrans, -1.0f, 0.0f, 2.0f, 0.0f, 0.0f, 0.0f, 0.5f, 0.5f, 0.5f, glm::vec4(0.5f, 0.5f, 0.5f, 1.0f)); // base
-
-        
-        // Animate the fan blades
-        // Fan rotation logic
 
-        if (isFanRotating) {
-            fanRotateAngle_Y += deltaTime * 100.0f;  // Increase the rotation angle to animate fan blades
-            if (fanRotateAngle_Y > 360.0f)
-                fanRotateAngle_Y -= 360.0f;
+        // camera/view transformation, from the interpolated camera
+        BasicCamera camera = basic_camera;
+        camera.Position = shown.cameraPosition;
+        camera.Yaw = shown.cameraYaw;
+        camera.Pitch = shown.cameraPitch;
+        camera.Roll = shown.cameraRoll;
+        camera.updateCameraVectors();
+        if (headless)
+            followCameraPath(camera, pathBounds, pathSeconds, CAMERA_PATH_SECONDS);
+        glm::mat4 view = camera.createViewMatrix();
+
+        // one upload per frame serves every program
+        if (!software)
+            frameUniforms.update(view, projection, camera.Position, currentFrame);
+        Frustum frustum = camera.createFrustum(projection);
+
+        drawList.clear();
+
+        // Draw Axes, in world space with their vertex colors
+        const Mesh& axesLines = meshCache.get(axesMesh);
+        DrawCommand axes = makeDrawCommand(staticShader, axesLines.VAO, GL_LINES, axesLines.indexCount, true);
+        axes.modelUniform = staticModel;
+        axes.model = glm::mat4(1.0f);
+        axes.bounds = axesLines.bounds;
+        axes.gpuScope = gpuAxes;
+        drawList.add(PASS_OPAQUE, 0, viewDepth(view, glm::vec3(0.0f)), axes);
+
+        // Move and rotate the entire room, and spin the fan; only nodes that changed are recomputed
+        hierarchy.setPosition(roomNode, shown.translate);
+        hierarchy.setRotation(roomNode, shown.rotate);
+        for (size_t i = 0; i < spinningNodes.size(); i++)
+            hierarchy.setRotation(spinningNodes[i], spinningRotations[i] + glm::vec3(0.0f, shown.fanAngle, 0.0f)); // Rotate the fans around Y-axis
+
+        hierarchy.update();
+
+        // Rasterize the room's occluders for this view
+        {
+            PROFILE_ZONE("occluders");
+            occlusion.begin(projection * view);
+            for (size_t i = 0; i < occluderNodes.size(); i++)
+            {
+                const Mesh& occluderMesh = meshCache.get(occluderMeshes[i]);
+                occlusion.addOccluder(occluderMesh.vertices, occluderMesh.indices, hierarchy.world(occluderNodes[i]));
+            }
+            occlusion.finish();
         }
 
-        // Create a transformation matrix for the fan
-        glm::mat4 fanTransform = glm::translate(parentTrans, glm::vec3(0.0f, 2.5f, 0.0f)); // Move fan above the floor
-        fanTransform = glm::rotate(fanTransform, glm::radians(fanRotateAngle_Y), glm::vec3(0.0f, 1.0f, 0.0f)); // Rotate the fan around Y-axis
-
-        // Draw Central Rod
-        drawCube(ourShader, VAO, fanTransform, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.5f, 0.2f, 0.5f, glm::vec4(0.5f, 0.5f, 0.5f, 1.0f)); // Rod
-        drawCube(ourShader, VAO, parentTrans, 0.0f, 2.65f, 0.0f, 0.0f, 0.0f, 0.0f, 0.05f, 0.5f, 0.05f, glm::vec4(0.5f, 0.5f, 0.5f, 1.0f)); // hanger
-
-        // Draw the 3 blades, using fanTransform as the parent transform
-        glm::mat4 bladeTransform;
-
-        // Blade 1 - Color Red
-        bladeTransform = glm::rotate(fanTransform, glm::radians(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));  // No rotation, Blade 1 starts at 0 degrees
-        drawCube(ourShader, VAO, bladeTransform, 0.5f, 0.0f, 0.0f, 20.0f, 0.0f, 0.0f, 2.0f, 0.05f, 0.2f, glm::vec4(0.702f, 1.0f, 1.0f, 1.0f));
-
-        // Blade 2 - Color Green
-        bladeTransform = glm::rotate(fanTransform, glm::radians(120.0f), glm::vec3(0.0f, 1.0f, 0.0f));  // Rotate 120 degrees around Y-axis
-        drawCube(ourShader, VAO, bladeTransform, 0.5f, 0.0f, 0.0f, 20.0f, 0.0f, 0.0f, 2.0f, 0.05f, 0.2f, glm::vec4(0.702f, 1.0f, 1.0f, 1.0f));
+        // Rod and blades, from their cached world matrices
+        cubeInstances.clear();
+        for (size_t i = 0; i < movingParts.size(); i++)
+        {
+            CubeInstance instance = { hierarchy.world(movingParts[i]), movingPartColors[i] };
+            cubeInstances.push_back(instance);
+        }
 
-        // Blade 3 - Color Blue
-        bladeTransform = glm::rotate(fanTransform, glm::radians(240.0f), glm::vec3(0.0f, 1.0f, 0.0f));  // Rotate 240 degrees around Y-axis
-        drawCube(ourShader, VAO, bladeTransform, 0.5f, 0.0f, 0.0f, 20.0f, 0.0f, 0.0f, 2.0f, 0.05f, 0.2f, glm::vec4(0.702f, 1.0f, 1.0f, 1.0f));
+        // Draw the static rooms (furniture and cylinder), one call per room
+        for (size_t b = 0; b < staticBatches.size(); b++)
+        {
+            const StaticBatch& staticBatch = staticBatches[b];
+            if (staticBatch.indexCount == 0)
+                continue;
+            const glm::mat4& anchorTrans = hierarchy.world(staticAnchors[b]);
+            DrawCommand room = makeDrawCommand(staticShader, staticBatch.VAO, GL_TRIANGLES, staticBatch.indexCount, true);
+            room.modelUniform = staticModel;
+            room.model = anchorTrans;
+            room.bounds = transformAABB(staticBatch.bounds, anchorTrans);
+            room.gpuScope = gpuStatic;
+            drawList.add(PASS_OPAQUE, 0, viewDepth(view, glm::vec3(anchorTrans[3])), room);
+            if (software && isVisible(frustum, room.bounds))
+                raster.drawIndexed(staticBatch.cpuVertices(), staticBatch.cpuIndices(), anchorTrans, projection * view);
+        }
 
-        // Draw Cylinder
-        glm::mat4 cylinderModel = glm::translate(parentTrans, glm::vec3(-1.0f, 1.0f, 2.0f)); // Position the cylinder as needed
-        ourShader.setMat4("model", cylinderModel);
-        glBindVertexArray(cylinderVAO);
-        glDrawElements(GL_TRIANGLES, cylinderIndices.size(), GL_UNSIGNED_INT, 0);
+        // Draw the moving fan parts of every room at once
+        if (cubeRenderer.cull(frustum, cubeInstances) > 0 && cubeRenderer.cullOccluded(occlusion, cubeInstances) > 0)
+        {
+            if (software)
+            {
+                const Mesh& cube = meshCache.get(cubeMesh);
+                for (size_t i = 0; i < cubeInstances.size(); i++)
+                    raster.drawIndexed(cube.vertices, cube.indices, cubeInstances[i].model, projection * view, &cubeInstances[i].color);
+            }
+            else
+            {
+                cubeRenderer.upload(cubeInstances);
+                DrawCommand fan = makeDrawCommand(instancedShader, cubeRenderer.VAO, GL_TRIANGLES, cubeRenderer.indexCount, true, (GLsizei)cubeInstances.size());
+                fan.gpuScope = gpuFan;
+                drawList.add(PASS_OPAQUE, 0, viewDepth(view, glm::vec3(cubeInstances[0].model[3])), fan);
+            }
+        }
 
+        // drop draws outside the view before sorting and submitting the rest
+        drawList.cull(frustum);
+        drawList.cullOccluded(occlusion);
+        occlusion.endFrame();
+        drawList.sort();
+        if (software)
+            raster.finish();
+        else
+            drawList.submit();
+        cubeRenderer.endFrame();
+        gpuTimer.end(gpuFrame);
+        if (capturing)
+            capture.capture();
+
+        // headless: a frame ends once the GPU has finished it; nothing is presented
+        if (headless)
+        {
+            glFinish();
+            if (software)
+                report.record(1000.0 * (glfwGetTime() - frameStart), raster.draws, raster.triangles, glState().issued);
+            else
+                report.record(1000.0 * (glfwGetTime() - frameStart), drawList.submitted, drawList.triangles, glState().issued);
+            if (golden && software)
+                goldenSuite.check(goldenPrefix + GOLDEN_POSES[frameCount - 1].name, raster.color);
+            else if (golden)
+            {
+                Image frame;
+                readFramebuffer(offscreen.width, offscreen.height, frame);
+                goldenSuite.check(goldenPrefix + GOLDEN_POSES[frameCount - 1].name, frame);
+            }
+            glfwPollEvents();
+            continue;
+        }
 
+        gpuTimer.printPeriodic(frameStart);
 
         // Swap buffers and poll IO events
-        glfwSwapBuffers(window);
+        {
+            PROFILE_ZONE("swap");
+            glfwSwapBuffers(window);
+        }
         glfwPollEvents();
     }
 
+    double loopSeconds = glfwGetTime() - loopStart;
+    gpuTimer.flush();
+    inputTape().close();
+    if (capturing)
+        capture.finish();
+    bool reported = true;
+    if (!tracePath.empty())
+        writeChromeTrace(tracePath);
+    // a golden run prints its own summary; its report is only written when asked for
+    if (headless && (!golden || !reportPath.empty()))
+        reported = report.write(reportPath, report.toJSON(scenePath, scene.size(), offscreen.width, offscreen.height,
+            software ? "software rasterizer" : (const char*)glGetString(GL_RENDERER), &gpuTimer));
+    if (headless)
+        offscreen.clear();
+    if (golden)
+    {
+        goldenSuite.printSummary();
+        reported = reported && goldenSuite.succeeded();
+    }
+
     // De-allocate resources
-    glDeleteVertexArrays(1, &VAO);
-    glDeleteBuffers(1, &VBO);
-    glDeleteBuffers(1, &EBO);
+    std::cout << "Frames: " << frameCount << " over " << scene.size() << " scene nodes, "
+        << 1000.0 * loopSeconds / (frameCount > 0 ? frameCount : 1) << " ms per frame" << std::endl;
+    meshCache.printStats();
+    drawList.printStats();
+    cubeRenderer.culling.printStats("Fan instance culling");
+    occlusion.printStats();
+    hierarchy.printStats();
+    timestep.printStats();
+    actions.printStats(input());
+    cubeRenderer.instanceStream.printStats();
+    glState().beginFrame();
+    glState().printStats();
+    glTrace().endFrame();
+    glTrace().printStats();
+    gpuTimer.printStats();
+    if (capturing)
+        capture.printStats(loopSeconds);
+    if (software)
+        raster.printStats();
+    capture.clear();
+    goldenSuite.clear();
+    raster.clear();
+    gpuTimer.clear();
+    frameUniforms.clear();
+    clearStaticBatches(staticBatches);
+    cubeRenderer.clear();
+    meshCache.clear();
 
     // Terminate GLFW
     glfwTerminate();
-    return 0;
+    return reported ? 0 : -1;
 }
 
-// Process input
-void processInput(GLFWwindow* window)
+// rates per second, equal to the old per-frame steps at 60 frames per second
+const float TRANSLATE_SPEED = 0.6f;
+const float ROTATE_SPEED = 60.0f;
+
+// Key bindings: every key the scene reacts to and what it does each simulation step
+void bindActions(ActionTable& actions)
 {
-    if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
-        glfwSetWindowShouldClose(window, true);
+    actions.bind(GLFW_KEY_ESCAPE, KEY_PRESSED, [](GLFWwindow* window, float) { glfwSetWindowShouldClose(window, true); });
 
-    if (glfwGetKey(window, GLFW_KEY_I) == GLFW_PRESS) translate_Y += 0.01;
-    if (glfwGetKey(window, GLFW_KEY_K) == GLFW_PRESS) translate_Y -= 0.01;
-    if (glfwGetKey(window, GLFW_KEY_L) == GLFW_PRESS) translate_X += 0.01;
-    if (glfwGetKey(window, GLFW_KEY_J) == GLFW_PRESS) translate_X -= 0.01;
-    if (glfwGetKey(window, GLFW_KEY_O) == GLFW_PRESS) translate_Z += 0.01;
-    if (glfwGetKey(window, GLFW_KEY_P) == GLFW_PRESS) translate_Z -= 0.01;
+    actions.bind(GLFW_KEY_I, KEY_HELD, [](GLFWwindow*, float dt) { translate_Y += TRANSLATE_SPEED * dt; });
+    actions.bind(GLFW_KEY_K, KEY_HELD, [](GLFWwindow*, float dt) { translate_Y -= TRANSLATE_SPEED * dt; });
+    actions.bind(GLFW_KEY_L, KEY_HELD, [](GLFWwindow*, float dt) { translate_X += TRANSLATE_SPEED * dt; });
+    actions.bind(GLFW_KEY_J, KEY_HELD, [](GLFWwindow*, float dt) { translate_X -= TRANSLATE_SPEED * dt; });
+    actions.bind(GLFW_KEY_O, KEY_HELD, [](GLFWwindow*, float dt) { translate_Z += TRANSLATE_SPEED * dt; });
+    actions.bind(GLFW_KEY_P, KEY_HELD, [](GLFWwindow*, float dt) { translate_Z -= TRANSLATE_SPEED * dt; });
 
-    if (glfwGetKey(window, GLFW_KEY_X) == GLFW_PRESS) rotateAngle_X += 1;
-    if (glfwGetKey(window, GLFW_KEY_Y) == GLFW_PRESS) rotateAngle_Y += 1;
-    if (glfwGetKey(window, GLFW_KEY_Z) == GLFW_PRESS) rotateAngle_Z += 1;
+    actions.bind(GLFW_KEY_X, KEY_HELD, [](GLFWwindow*, float dt) { rotateAngle_X += ROTATE_SPEED * dt; });
+    actions.bind(GLFW_KEY_Y, KEY_HELD, [](GLFWwindow*, float dt) { rotateAngle_Y += ROTATE_SPEED * dt; });
+    actions.bind(GLFW_KEY_Z, KEY_HELD, [](GLFWwindow*, float dt) { rotateAngle_Z += ROTATE_SPEED * dt; });
 
     // Camera movement
-    if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
-        basic_camera.ProcessKeyboard('W', deltaTime);  // Forward
-    if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
-        basic_camera.ProcessKeyboard('S', deltaTime);  // Backward
-    if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
-        basic_camera.ProcessKeyboard('A', deltaTime);  // Left
-    if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
-        basic_camera.ProcessKeyboard('D', deltaTime);  // Right
-    if (glfwGetKey(window, GLFW_KEY_E) == GLFW_PRESS)
-        basic_camera.ProcessKeyboard('E', deltaTime);  // Up
-    if (glfwGetKey(window, GLFW_KEY_R) == GLFW_PRESS)
-        basic_camera.ProcessKeyboard('R', deltaTime);  // Down
+    actions.bind(GLFW_KEY_W, KEY_HELD, [](GLFWwindow*, float dt) { basic_camera.ProcessKeyboard('W', dt); });  // Forward
+    actions.bind(GLFW_KEY_S, KEY_HELD, [](GLFWwindow*, float dt) { basic_camera.ProcessKeyboard('S', dt); });  // Backward
+    actions.bind(GLFW_KEY_A, KEY_HELD, [](GLFWwindow*, float dt) { basic_camera.ProcessKeyboard('A', dt); });  // Left
+    actions.bind(GLFW_KEY_D, KEY_HELD, [](GLFWwindow*, float dt) { basic_camera.ProcessKeyboard('D', dt); });  // Right
+    actions.bind(GLFW_KEY_E, KEY_HELD, [](GLFWwindow*, float dt) { basic_camera.ProcessKeyboard('E', dt); });  // Up
+    actions.bind(GLFW_KEY_R, KEY_HELD, [](GLFWwindow*, float dt) { basic_camera.ProcessKeyboard('R', dt); });  // Down
 
     // Camera rotation
-    if (glfwGetKey(window, GLFW_KEY_UP) == GLFW_PRESS)
-        basic_camera.ProcessRotation('P', deltaTime);  // Pitch up
-    if (glfwGetKey(window, GLFW_KEY_DOWN) == GLFW_PRESS)
-        basic_camera.ProcessRotation('N', deltaTime);  // Pitch down
-    if (glfwGetKey(window, GLFW_KEY_LEFT) == GLFW_PRESS)
-        basic_camera.ProcessRotation('Y', deltaTime);  // Yaw left
-    if (glfwGetKey(window, GLFW_KEY_RIGHT) == GLFW_PRESS)
-        basic_camera.ProcessRotation('H', deltaTime);  // Yaw right
-    if (glfwGetKey(window, GLFW_KEY_1) == GLFW_PRESS)
-        basic_camera.ProcessRotation('L', deltaTime);  // Roll counter-clockwise
-    if (glfwGetKey(window, GLFW_KEY_3) == GLFW_PRESS)
-        basic_camera.ProcessRotation('R', deltaTime);  // Roll clockwise
+    actions.bind(GLFW_KEY_UP, KEY_HELD, [](GLFWwindow*, float dt) { basic_camera.ProcessRotation('P', dt); });     // Pitch up
+    actions.bind(GLFW_KEY_DOWN, KEY_HELD, [](GLFWwindow*, float dt) { basic_camera.ProcessRotation('N', dt); });   // Pitch down
+    actions.bind(GLFW_KEY_LEFT, KEY_HELD, [](GLFWwindow*, float dt) { basic_camera.ProcessRotation('Y', dt); });   // Yaw left
+    actions.bind(GLFW_KEY_RIGHT, KEY_HELD, [](GLFWwindow*, float dt) { basic_camera.ProcessRotation('H', dt); });  // Yaw right
+    actions.bind(GLFW_KEY_1, KEY_HELD, [](GLFWwindow*, float dt) { basic_camera.ProcessRotation('L', dt); });      // Roll counter-clockwise
+    actions.bind(GLFW_KEY_3, KEY_HELD, [](GLFWwindow*, float dt) { basic_camera.ProcessRotation('R', dt); });      // Roll clockwise
 
     // Toggle fan rotation with 'G' key
-    static bool gPressedLastFrame = false;
-    if (glfwGetKey(window, GLFW_KEY_G) == GLFW_PRESS && !gPressedLastFrame) {
-        isFanRotating = !isFanRotating;
-        gPressedLastFrame = true;
-    }
-    if (glfwGetKey(window, GLFW_KEY_G) == GLFW_RELEASE) {
-        gPressedLastFrame = false;
-    }
+    actions.bind(GLFW_KEY_G, KEY_PRESSED, [](GLFWwindow*, float) { isFanRotating = !isFanRotating; });
 }
 
-// Framebuffer size callback
-void framebuffer_size_callback(GLFWwindow* window, int width, int height)
+// Advance the animation by one simulation step
+void simulate(float stepSeconds)
 {
-    glViewport(0, 0, width, height);
+    // Animate the fan blades
+    if (isFanRotating) {
+        fanRotateAngle_Y += stepSeconds * 100.0f;  // Increase the rotation angle to animate fan blades
+        if (fanRotateAngle_Y > 360.0f)
+            fanRotateAngle_Y -= 360.0f;
+    }
 }
 
-// Scroll callback
-void scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
+// Snapshot and blend of the simulated state
+SimulationState captureSimulationState()
 {
-    basic_camera.ProcessMouseScroll(static_cast<float>(yoffset));
+    SimulationState state;
+    state.translate = glm::vec3(translate_X, translate_Y, translate_Z);
+    state.rotate = glm::vec3(rotateAngle_X, rotateAngle_Y, rotateAngle_Z);
+    state.fanAngle = fanRotateAngle_Y;
+    state.cameraPosition = basic_camera.Position;
+    state.cameraYaw = basic_camera.Yaw;
+    state.cameraPitch = basic_camera.Pitch;
+    state.cameraRoll = basic_camera.Roll;
+    return state;
 }
 
-// Draw Cube Function
-void drawCube(Shader shaderProgram, unsigned int VAO, glm::mat4 parentTrans,
-    float posX, float posY, float posZ,
-    float rotX, float rotY, float rotZ,
-    float scX, float scY, float scZ,
-    glm::vec4 color)
+SimulationState interpolateSimulationState(const SimulationState& previous, const SimulationState& current, float alpha)
 {
-    shaderProgram.use();
-
-    // Apply transformations: translation, rotation, scaling
-    glm::mat4 translateMatrix, rotateXMatrix, rotateYMatrix, rotateZMatrix, model, modelCentered;
-    translateMatrix = glm::translate(parentTrans, glm::vec3(posX, posY, posZ));
-    rotateXMatrix = glm::rotate(translateMatrix, glm::radians(rotX), glm::vec3(1.0f, 0.0f, 0.0f));
-    rotateYMatrix = glm::rotate(rotateXMatrix, glm::radians(rotY), glm::vec3(0.0f, 1.0f, 0.0f));
-    rotateZMatrix = glm::rotate(rotateYMatrix, glm::radians(rotZ), glm::vec3(0.0f, 0.0f, 1.0f));
-    model = glm::scale(rotateZMatrix, glm::vec3(scX, scY, scZ));
-    modelCentered = glm::translate(model, glm::vec3(-0.25f, -0.25f, -0.25f));
-
-    // Set the model transformation in the shader
-    shaderProgram.setMat4("model", modelCentered);
-
-    // Use the custom color passed to the function
-    shaderProgram.setVec4("color", color);
-
-    // Draw the cube
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
+    SimulationState state;
+    state.translate = glm::mix(previous.translate, current.translate, alpha);
+    state.rotate = glm::mix(previous.rotate, current.rotate, alpha);
+    state.fanAngle = lerpAngle(previous.fanAngle, current.fanAngle, alpha);
+    state.cameraPosition = glm::mix(previous.cameraPosition, current.cameraPosition, alpha);
+    state.cameraYaw = glm::mix(previous.cameraYaw, current.cameraYaw, alpha);
+    state.cameraPitch = glm::mix(previous.cameraPitch, current.cameraPitch, alpha);
+    state.cameraRoll = glm::mix(previous.cameraRoll, current.cameraRoll, alpha);
+    return state;
 }
 
-void generateCylinderVertices(std::vector<float>& vertices, std::vector<unsigned int>& indices, int segments, float height, float radius) {
-    // Top center vertex
-    vertices.push_back(0.0f);
-    vertices.push_back(height / 2.0f);
-    vertices.push_back(0.0f);
-    vertices.push_back(0.702f); // r
-    vertices.push_back(1.0f); // g
-    vertices.push_back(1.0f); // b
-
-    // Bottom center vertex
-    vertices.push_back(0.0f);
-    vertices.push_back(-height / 2.0f);
-    vertices.push_back(0.0f);
-    vertices.push_back(0.702f); // r
-    vertices.push_back(1.0f); // g
-    vertices.push_back(1.0f); // b
-
-    // Generate vertices around the top and bottom circles
-    for (int i = 0; i <= segments; i++) {
-        float angle = 2.0f * 3.1416 * i / segments;
-        float x = radius * cos(angle);
-        float z = radius * sin(angle);
-
-        // Top circle vertex
-        vertices.push_back(x);
-        vertices.push_back(height / 2.0f);
-        vertices.push_back(z);
-        vertices.push_back(0.702f); // r
-        vertices.push_back(1.0f); // g
-        vertices.push_back(1.0f); // b
-
-        // Bottom circle vertex
-        vertices.push_back(x);
-        vertices.push_back(-height / 2.0f);
-        vertices.push_back(z);
-        vertices.push_back(0.702f); // r
-        vertices.push_back(1.0f); // g
-        vertices.push_back(1.0f); // b
-    }
-
-    // Generate indices for the top and bottom circles
-    for (int i = 0; i < segments; i++) {
-        // Top circle
-        indices.push_back(0);
-        indices.push_back(2 + 2 * i);
-        indices.push_back(2 + 2 * ((i + 1) % segments));
-
-        // Bottom circle
-        indices.push_back(1);
-        indices.push_back(3 + 2 * i);
-        indices.push_back(3 + 2 * ((i + 1) % segments));
-
-        // Side triangles
-        int top1 = 2 + 2 * i;
-        int top2 = 2 + 2 * ((i + 1) % segments);
-        int bottom1 = top1 + 1;
-        int bottom2 = top2 + 1;
-
-        indices.push_back(top1);
-        indices.push_back(bottom1);
-        indices.push_back(top2);
-
-        indices.push_back(bottom1);
-        indices.push_back(bottom2);
-        indices.push_back(top2);
-    }
+// Framebuffer size callback
+void framebuffer_size_callback(GLFWwindow* window, int width, int height)
+{
+    glViewport(0, 0, width, height);
 }
 
-
-
+// Scroll callback: like keys, the wheel goes through the input tape and is applied by the next simulation step
+void scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
+{
+    inputTape().onScroll(static_cast<float>(yoffset));
+}
@@ -0,0 +1,335 @@
+#pragma once
+//
+//  mesh_cache.h
+//  3D Object Drawing
+//
+//  Builds and uploads procedural primitives once and hands out stable handles,
+//  so the render loop never regenerates or re-uploads geometry.
+//
+
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+#include <glad/glad.h>
+
+#include "gl_state_cache.h"
+#include "frustum.h"
+#include "profiler.h"
+
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <functional>
+#include <iostream>
+#include <cmath>
+#include <cstddef>
+
+enum PrimitiveType
+{
+    PRIMITIVE_CUBE,
+    PRIMITIVE_CYLINDER,
+    PRIMITIVE_AXES              // GL_LINES, not triangles; height is the length of each axis
+};
+
+// identifies one generated mesh; parameters a primitive does not use stay 0
+struct MeshKey
+{
+    PrimitiveType type;
+    int segments;
+    float height;
+    float radius;
+
+    bool operator==(const MeshKey& other) const
+    {
+        return type == other.type && segments == other.segments &&
+            height == other.height && radius == other.radius;
+    }
+};
+
+struct MeshKeyHash
+{
+    size_t operator()(const MeshKey& key) const
+    {
+        size_t h = std::hash<int>()(key.type);
+        h = h * 31 + std::hash<int>()(key.segments);
+        h = h * 31 + std::hash<float>()(key.height);
+        h = h * 31 + std::hash<float>()(key.radius);
+        return h;
+    }
+};
+
+// one resident mesh (interleaved position + color, 6 floats per vertex); the CPU copy
+// is kept so static batches can merge it without regenerating
+struct Mesh
+{
+    MeshKey key;
+    unsigned int VAO, VBO, EBO;
+    unsigned int vertexCount;
+    unsigned int indexCount;
+    size_t bytes;
+    AABB bounds;                // local space
+    std::vector<float> vertices;
+    std::vector<unsigned int> indices;
+};
+
+// handles index into the cache and stay valid until clear(), as do references from get()
+typedef unsigned int MeshHandle;
+
+void generateCubeVertices(std::vector<float>& vertices, std::vector<unsigned int>& indices);
+void generateCylinderVertices(std::vector<float>& vertices, std::vector<unsigned int>& indices, int segments, float height, float radius);
+void generateAxesVertices(std::vector<float>& vertices, std::vector<unsigned int>& indices, float length);
+
+class MeshCache
+{
+public:
+    size_t hits = 0;
+    size_t misses = 0;
+
+    // returns the handle of the mesh for these parameters, building and uploading it on first use
+    // ------------------------------------------------------------------------
+    MeshHandle acquire(PrimitiveType type, int segments = 0, float height = 0.0f, float radius = 0.0f)
+    {
+        MeshKey key = { type, segments, height, radius };
+        std::unordered_map<MeshKey, MeshHandle, MeshKeyHash>::const_iterator it = lookup.find(key);
+        if (it != lookup.end())
+        {
+            hits++;
+            return it->second;
+        }
+        misses++;
+
+        std::vector<float> vertices;
+        std::vector<unsigned int> indices;
+        switch (type)
+        {
+        case PRIMITIVE_CUBE:
+            generateCubeVertices(vertices, indices);
+            break;
+        case PRIMITIVE_CYLINDER:
+            generateCylinderVertices(vertices, indices, segments, height, radius);
+            break;
+        case PRIMITIVE_AXES:
+            generateAxesVertices(vertices, indices, height);
+            break;
+        }
+
+        MeshHandle handle = (MeshHandle)meshes.size();
+        meshes.push_back(upload(key, vertices, indices));
+        meshes.back().vertices.swap(vertices);
+        meshes.back().indices.swap(indices);
+        lookup[key] = handle;
+        return handle;
+    }
+    // the reference stays valid across later acquire() calls, until clear()
+    // ------------------------------------------------------------------------
+    const Mesh& get(MeshHandle handle) const
+    {
+        return meshes[handle];
+    }
+    // ------------------------------------------------------------------------
+    void draw(MeshHandle handle) const
+    {
+        const Mesh& mesh = meshes[handle];
+        glState().bindVertexArray(mesh.VAO);
+        glDrawElements(mesh.key.type == PRIMITIVE_AXES ? GL_LINES : GL_TRIANGLES, mesh.indexCount, GL_UNSIGNED_INT, 0);
+    }
+    // residency
+    // ------------------------------------------------------------------------
+    size_t residentCount() const
+    {
+        return meshes.size();
+    }
+    size_t residentBytes() const
+    {
+        size_t total = 0;
+        for (size_t i = 0; i < meshes.size(); i++)
+            total += meshes[i].bytes;
+        return total;
+    }
+    // ------------------------------------------------------------------------
+    void printStats() const
+    {
+        std::cout << "MeshCache: " << residentCount() << " meshes resident, "
+            << residentBytes() << " bytes, " << hits << " hits, " << misses << " misses" << std::endl;
+    }
+    // deletes every GL object; must run while the context is still current
+    // ------------------------------------------------------------------------
+    void clear()
+    {
+        for (size_t i = 0; i < meshes.size(); i++)
+        {
+            glState().deleteVertexArray(meshes[i].VAO);
+            glState().deleteBuffer(meshes[i].VBO);
+            glState().deleteBuffer(meshes[i].EBO);
+        }
+        meshes.clear();
+        lookup.clear();
+    }
+
+private:
+    // a deque never moves its elements when it grows, so get() references stay put
+    std::deque<Mesh> meshes;
+    std::unordered_map<MeshKey, MeshHandle, MeshKeyHash> lookup;
+
+    // ------------------------------------------------------------------------
+    static Mesh upload(const MeshKey& key, const std::vector<float>& vertices, const std::vector<unsigned int>& indices)
+    {
+        Mesh mesh;
+        mesh.key = key;
+        mesh.vertexCount = (unsigned int)(vertices.size() / 6);
+        mesh.indexCount = (unsigned int)indices.size();
+        mesh.bytes = vertices.size() * sizeof(float) + indices.size() * sizeof(unsigned int);
+        mesh.bounds = emptyAABB();
+        for (size_t v = 0; v + 2 < vertices.size(); v += 6)
+            growAABB(mesh.bounds, glm::vec3(vertices[v], vertices[v + 1], vertices[v + 2]));
+
+        glGenVertexArrays(1, &mesh.VAO);
+        glGenBuffers(1, &mesh.VBO);
+        glGenBuffers(1, &mesh.EBO);
+
+        glState().bindVertexArray(mesh.VAO);
+
+        glState().bindBuffer(GL_ARRAY_BUFFER, mesh.VBO);
+        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
+
+        glState().bindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.EBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+
+        // position attribute
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
+        glEnableVertexAttribArray(0);
+
+        // color attribute
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
+        glEnableVertexAttribArray(1);
+
+        return mesh;
+    }
+};
+
+// unit cube spanning [0, 0.5] on every axis; drawCube() re-centers it
+inline void generateCubeVertices(std::vector<float>& vertices, std::vector<unsigned int>& indices)
+{
+    static const float cube_vertices[] = {
+        // positions          // colors
+        0.0f, 0.0f, 0.0f, 0.3f, 0.8f, 0.5f,
+        0.5f, 0.0f, 0.0f, 0.5f, 0.4f, 0.3f,
+        0.5f, 0.5f, 0.0f, 0.2f, 0.7f, 0.3f,
+        0.0f, 0.5f, 0.0f, 0.6f, 0.2f, 0.8f,
+        0.0f, 0.0f, 0.5f, 0.8f, 0.3f, 0.6f,
+        0.5f, 0.0f, 0.5f, 0.4f, 0.4f, 0.8f,
+        0.5f, 0.5f, 0.5f, 0.2f, 0.3f, 0.6f,
+        0.0f, 0.5f, 0.5f, 0.7f, 0.5f, 0.4f
+    };
+    static const unsigned int cube_indices[] = {
+        0, 3, 2,
+        2, 1, 0,
+
+        1, 2, 6,
+        6, 5, 1,
+
+        5, 6, 7,
+        7, 4, 5,
+
+        4, 7, 3,
+        3, 0, 4,
+
+        6, 2, 3,
+        3, 7, 6,
+
+        1, 5, 4,
+        4, 0, 1
+    };
+
+    vertices.assign(cube_vertices, cube_vertices + sizeof(cube_vertices) / sizeof(float));
+    indices.assign(cube_indices, cube_indices + sizeof(cube_indices) / sizeof(unsigned int));
+}
+
+// x, y and z axes from the origin as three red, green and blue lines
+inline void generateAxesVertices(std::vector<float>& vertices, std::vector<unsigned int>& indices, float length)
+{
+    vertices.clear();
+    indices.clear();
+    for (int axis = 0; axis < 3; axis++)
+    {
+        glm::vec3 color(0.0f);
+        color[axis] = 1.0f;
+        glm::vec3 end(0.0f);
+        end[axis] = length;
+        vertices.insert(vertices.end(), { 0.0f, 0.0f, 0.0f, color.r, color.g, color.b });
+        vertices.insert(vertices.end(), { end.x, end.y, end.z, color.r, color.g, color.b });
+        indices.push_back(axis * 2);
+        indices.push_back(axis * 2 + 1);
+    }
+}
+
+inline void generateCylinderVertices(std::vector<float>& vertices, std::vector<unsigned int>& indices, int segments, float height, float radius) {
+    PROFILE_ZONE("generateCylinderVertices");
+    // Top center vertex
+    vertices.push_back(0.0f);
+    vertices.push_back(height / 2.0f);
+    vertices.push_back(0.0f);
+    vertices.push_back(0.702f); // r
+    vertices.push_back(1.0f); // g
+    vertices.push_back(1.0f); // b
+
+    // Bottom center vertex
+    vertices.push_back(0.0f);
+    vertices.push_back(-height / 2.0f);
+    vertices.push_back(0.0f);
+    vertices.push_back(0.702f); // r
+    vertices.push_back(1.0f); // g
+    vertices.push_back(1.0f); // b
+
+    // Generate vertices around the top and bottom circles
+    for (int i = 0; i <= segments; i++) {
+        float angle = 2.0f * 3.1416f * i / segments;
+        float x = radius * cos(angle);
+        float z = radius * sin(angle);
+
+        // Top circle vertex
+        vertices.push_back(x);
+        vertices.push_back(height / 2.0f);
+        vertices.push_back(z);
+        vertices.push_back(0.702f); // r
+        vertices.push_back(1.0f); // g
+        vertices.push_back(1.0f); // b
+
+        // Bottom circle vertex
+        vertices.push_back(x);
+        vertices.push_back(-height / 2.0f);
+        vertices.push_back(z);
+        vertices.push_back(0.702f); // r
+        vertices.push_back(1.0f); // g
+        vertices.push_back(1.0f); // b
+    }
+
+    // Generate indices for the top and bottom circles
+    for (int i = 0; i < segments; i++) {
+        // Top circle
+        indices.push_back(0);
+        indices.push_back(2 + 2 * i);
+        indices.push_back(2 + 2 * ((i + 1) % segments));
+
+        // Bottom circle
+        indices.push_back(1);
+        indices.push_back(3 + 2 * i);
+        indices.push_back(3 + 2 * ((i + 1) % segments));
+
+        // Side triangles
+        int top1 = 2 + 2 * i;
+        int top2 = 2 + 2 * ((i + 1) % segments);
+        int bottom1 = top1 + 1;
+        int bottom2 = top2 + 1;
+
+        indices.push_back(top1);
+        indices.push_back(bottom1);
+        indices.push_back(top2);
+
+        indices.push_back(bottom1);
+        indices.push_back(bottom2);
+        indices.push_back(top2);
+    }
+}
+
+#endif
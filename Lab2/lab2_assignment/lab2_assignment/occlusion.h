@@ -0,0 +1,283 @@
+#pragma once
+//
+//  occlusion.h
+//  3D Object Drawing
+//
+//  CPU occlusion culling. A few large occluders (walls, floor) are rasterized
+//  every frame into a small depth buffer, which is reduced into a max-depth
+//  pyramid. A bounding box is occluded when its nearest projected depth lies
+//  behind the farthest occluder depth over every texel it covers; the level is
+//  picked so that test touches at most a few texels.
+//
+
+#ifndef OCCLUSION_H
+#define OCCLUSION_H
+
+#include <glm/glm.hpp>
+
+#include "frustum.h"
+
+#include <vector>
+#include <chrono>
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+class OcclusionBuffer
+{
+public:
+    int width = 0, height = 0;
+    // per-frame counters, accumulated into the totals by endFrame()
+    size_t occluderTriangles = 0;
+    size_t tested = 0;
+    size_t occluded = 0;
+    double rasterMs = 0.0;
+    double testMs = 0.0;
+    size_t frames = 0;
+    size_t totalTested = 0;
+    size_t totalOccluded = 0;
+    double totalRasterMs = 0.0;
+    double totalTestMs = 0.0;
+
+    // ------------------------------------------------------------------------
+    void init(int bufferWidth = 256, int bufferHeight = 128)
+    {
+        width = bufferWidth;
+        height = bufferHeight;
+        levels.clear();
+        levelWidth.clear();
+        levelHeight.clear();
+        int w = width, h = height;
+        while (true)
+        {
+            levels.push_back(std::vector<float>((size_t)w * h, 1.0f));
+            levelWidth.push_back(w);
+            levelHeight.push_back(h);
+            if (w == 1 && h == 1)
+                break;
+            w = (w + 1) / 2;
+            h = (h + 1) / 2;
+        }
+    }
+    // clears the depth buffer for a new view; occluders and tests use this matrix
+    // ------------------------------------------------------------------------
+    void begin(const glm::mat4& viewProjectionMatrix)
+    {
+        viewProjection = viewProjectionMatrix;
+        std::fill(levels[0].begin(), levels[0].end(), 1.0f);
+        occluderTriangles = tested = occluded = 0;
+        rasterMs = testMs = 0.0;
+    }
+    // rasterizes an indexed triangle mesh (6 floats per vertex, position first) placed by model
+    // ------------------------------------------------------------------------
+    void addOccluder(const std::vector<float>& vertices, const std::vector<unsigned int>& indices, const glm::mat4& model)
+    {
+        std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+        glm::mat4 toClip = viewProjection * model;
+        clipVertices.resize(vertices.size() / 6);
+        for (size_t v = 0; v < clipVertices.size(); v++)
+            clipVertices[v] = toClip * glm::vec4(vertices[v * 6], vertices[v * 6 + 1], vertices[v * 6 + 2], 1.0f);
+        for (size_t i = 0; i + 2 < indices.size(); i += 3)
+            drawTriangle(clipVertices[indices[i]], clipVertices[indices[i + 1]], clipVertices[indices[i + 2]]);
+        occluderTriangles += indices.size() / 3;
+        rasterMs += elapsedMs(start);
+    }
+    // builds the max-depth pyramid; call after the last occluder and before any test
+    // ------------------------------------------------------------------------
+    void finish()
+    {
+        std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+        for (size_t l = 1; l < levels.size(); l++)
+        {
+            const std::vector<float>& src = levels[l - 1];
+            std::vector<float>& dst = levels[l];
+            int sw = levelWidth[l - 1], sh = levelHeight[l - 1];
+            for (int y = 0; y < levelHeight[l]; y++)
+                for (int x = 0; x < levelWidth[l]; x++)
+                {
+                    int x0 = x * 2, y0 = y * 2;
+                    int x1 = std::min(x0 + 1, sw - 1), y1 = std::min(y0 + 1, sh - 1);
+                    float d = std::max(std::max(src[y0 * sw + x0], src[y0 * sw + x1]), std::max(src[y1 * sw + x0], src[y1 * sw + x1]));
+                    dst[y * levelWidth[l] + x] = d;
+                }
+        }
+        rasterMs += elapsedMs(start);
+    }
+    // true when the box is certainly hidden behind the occluders; boxes crossing the near plane are never occluded
+    // ------------------------------------------------------------------------
+    bool isOccluded(const AABB& box)
+    {
+        bool hidden = testBox(box);
+        tested++;
+        if (hidden)
+            occluded++;
+        return hidden;
+    }
+    // removes the items whose bounds(item) are occluded, keeping the order of the rest; returns how many remain
+    // ------------------------------------------------------------------------
+    template <class T, class BoundsFunc>
+    size_t removeOccluded(std::vector<T>& items, BoundsFunc bounds)
+    {
+        std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+        size_t kept = 0;
+        for (size_t i = 0; i < items.size(); i++)
+            if (!isOccluded(bounds(items[i])))
+                items[kept++] = items[i];
+        items.resize(kept);
+        testMs += elapsedMs(start);
+        return kept;
+    }
+    // ------------------------------------------------------------------------
+    void endFrame()
+    {
+        frames++;
+        totalTested += tested;
+        totalOccluded += occluded;
+        totalRasterMs += rasterMs;
+        totalTestMs += testMs;
+    }
+    // ------------------------------------------------------------------------
+    void printStats() const
+    {
+        size_t n = frames > 0 ? frames : 1;
+        double rate = totalTested > 0 ? 100.0 * totalOccluded / totalTested : 0.0;
+        std::cout << "OcclusionBuffer: " << width << "x" << height << ", " << totalOccluded / n << " of " << totalTested / n
+            << " tests occluded per frame (" << rate << "%), raster " << totalRasterMs / n << " ms, tests "
+            << totalTestMs / n << " ms per frame" << std::endl;
+    }
+    // depth at level 0, 0 = near plane, 1 = far plane or empty
+    // ------------------------------------------------------------------------
+    float depthAt(int x, int y) const
+    {
+        return levels[0][(size_t)y * width + x];
+    }
+
+private:
+    glm::mat4 viewProjection;
+    std::vector<std::vector<float> > levels;
+    std::vector<int> levelWidth, levelHeight;
+    std::vector<glm::vec4> clipVertices;
+
+    static double elapsedMs(std::chrono::high_resolution_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    }
+
+    // clips against the near plane (z >= -w), then rasterizes the resulting fan
+    // ------------------------------------------------------------------------
+    void drawTriangle(const glm::vec4& a, const glm::vec4& b, const glm::vec4& c)
+    {
+        glm::vec4 in[3] = { a, b, c };
+        glm::vec4 out[4];
+        int n = 0;
+        for (int i = 0; i < 3; i++)
+        {
+            const glm::vec4& p = in[i];
+            const glm::vec4& q = in[(i + 1) % 3];
+            float dp = p.z + p.w, dq = q.z + q.w;
+            if (dp >= 0.0f)
+                out[n++] = p;
+            if ((dp >= 0.0f) != (dq >= 0.0f))
+                out[n++] = p + (q - p) * (dp / (dp - dq));
+        }
+        for (int i = 1; i + 1 < n; i++)
+            rasterize(toScreen(out[0]), toScreen(out[i]), toScreen(out[i + 1]));
+    }
+    // clip space to (pixel x, pixel y, depth in [0, 1])
+    glm::vec3 toScreen(const glm::vec4& clip) const
+    {
+        float invW = 1.0f / std::max(clip.w, 1.0e-6f);
+        return glm::vec3((clip.x * invW * 0.5f + 0.5f) * width, (clip.y * invW * 0.5f + 0.5f) * height, clip.z * invW * 0.5f + 0.5f);
+    }
+    // occluders must under-cover: a texel is written only when the triangle covers
+    // all of it, so every edge function is shrunk by its value across half a texel,
+    // and the depth stored is the farthest the triangle reaches inside that texel
+    // ------------------------------------------------------------------------
+    void rasterize(glm::vec3 v0, glm::vec3 v1, glm::vec3 v2)
+    {
+        float area = (v1.x - v0.x) * (v2.y - v0.y) - (v1.y - v0.y) * (v2.x - v0.x);
+        if (area == 0.0f)
+            return;
+        if (area < 0.0f)
+        {
+            std::swap(v1, v2);
+            area = -area;
+        }
+
+        int minX = std::max(0, (int)std::floor(std::min(v0.x, std::min(v1.x, v2.x))));
+        int maxX = std::min(width - 1, (int)std::ceil(std::max(v0.x, std::max(v1.x, v2.x))));
+        int minY = std::max(0, (int)std::floor(std::min(v0.y, std::min(v1.y, v2.y))));
+        int maxY = std::min(height - 1, (int)std::ceil(std::max(v0.y, std::max(v1.y, v2.y))));
+        float invArea = 1.0f / area;
+
+        // per-pixel steps of each edge function, and of depth
+        float a0 = -(v2.y - v1.y), b0 = v2.x - v1.x;
+        float a1 = -(v0.y - v2.y), b1 = v0.x - v2.x;
+        float a2 = -(v1.y - v0.y), b2 = v1.x - v0.x;
+        float shrink0 = 0.5f * (std::fabs(a0) + std::fabs(b0));
+        float shrink1 = 0.5f * (std::fabs(a1) + std::fabs(b1));
+        float shrink2 = 0.5f * (std::fabs(a2) + std::fabs(b2));
+        float dzdx = (a0 * v0.z + a1 * v1.z + a2 * v2.z) * invArea;
+        float dzdy = (b0 * v0.z + b1 * v1.z + b2 * v2.z) * invArea;
+        float zSpread = 0.5f * (std::fabs(dzdx) + std::fabs(dzdy));
+
+        std::vector<float>& depth = levels[0];
+        for (int y = minY; y <= maxY; y++)
+        {
+            float py = y + 0.5f;
+            for (int x = minX; x <= maxX; x++)
+            {
+                float px = x + 0.5f;
+                float w0 = (v2.x - v1.x) * (py - v1.y) - (v2.y - v1.y) * (px - v1.x);
+                float w1 = (v0.x - v2.x) * (py - v2.y) - (v0.y - v2.y) * (px - v2.x);
+                float w2 = (v1.x - v0.x) * (py - v0.y) - (v1.y - v0.y) * (px - v0.x);
+                if (w0 < shrink0 || w1 < shrink1 || w2 < shrink2)
+                    continue;
+                float z = (w0 * v0.z + w1 * v1.z + w2 * v2.z) * invArea + zSpread;
+                float& d = depth[(size_t)y * width + x];
+                if (z < d)
+                    d = std::max(z, 0.0f);
+            }
+        }
+    }
+    // ------------------------------------------------------------------------
+    bool testBox(const AABB& box) const
+    {
+        float minX = 1.0e30f, minY = 1.0e30f, maxX = -1.0e30f, maxY = -1.0e30f, minZ = 1.0e30f;
+        for (int i = 0; i < 8; i++)
+        {
+            glm::vec3 corner((i & 1) ? box.max.x : box.min.x, (i & 2) ? box.max.y : box.min.y, (i & 4) ? box.max.z : box.min.z);
+            glm::vec4 clip = viewProjection * glm::vec4(corner, 1.0f);
+            if (clip.z < -clip.w || clip.w <= 1.0e-6f)
+                return false;
+            glm::vec3 s = toScreen(clip);
+            minX = std::min(minX, s.x); maxX = std::max(maxX, s.x);
+            minY = std::min(minY, s.y); maxY = std::max(maxY, s.y);
+            minZ = std::min(minZ, s.z);
+        }
+        if (maxX < 0.0f || maxY < 0.0f || minX >= width || minY >= height)
+            return false;   // off screen: left to the frustum test
+
+        int x0 = std::max(0, (int)std::floor(minX)), x1 = std::min(width - 1, (int)std::floor(maxX));
+        int y0 = std::max(0, (int)std::floor(minY)), y1 = std::min(height - 1, (int)std::floor(maxY));
+
+        // coarsest useful level: the rectangle covers at most 4x4 texels
+        size_t level = 0;
+        while (level + 1 < levels.size() && ((x1 - x0) >= 4 || (y1 - y0) >= 4))
+        {
+            x0 >>= 1; x1 >>= 1; y0 >>= 1; y1 >>= 1;
+            level++;
+        }
+
+        const std::vector<float>& depth = levels[level];
+        int w = levelWidth[level];
+        for (int y = y0; y <= y1; y++)
+            for (int x = x0; x <= x1; x++)
+                if (minZ <= depth[(size_t)y * w + x])
+                    return false;
+        return true;
+    }
+};
+
+#endif
@@ -0,0 +1,66 @@
+#pragma once
+//
+//  offscreen_target.h
+//  3D Object Drawing
+//
+//  A framebuffer object with color and depth renderbuffers, for frames that
+//  are rendered without being shown: headless benchmark runs and the golden
+//  image suite.
+//
+
+#ifndef OFFSCREEN_TARGET_H
+#define OFFSCREEN_TARGET_H
+
+#include <glad/glad.h>
+
+#include <iostream>
+
+// color + depth renderbuffers behind one framebuffer object
+class OffscreenTarget
+{
+public:
+    unsigned int FBO = 0, colorBuffer = 0, depthBuffer = 0;
+    int width = 0, height = 0;
+
+    // ------------------------------------------------------------------------
+    bool init(int targetWidth, int targetHeight)
+    {
+        width = targetWidth;
+        height = targetHeight;
+        glGenFramebuffers(1, &FBO);
+        glGenRenderbuffers(1, &colorBuffer);
+        glGenRenderbuffers(1, &depthBuffer);
+
+        glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+        glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+        GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+        if (status != GL_FRAMEBUFFER_COMPLETE)
+        {
+            std::cout << "ERROR::OFFSCREEN_TARGET::INCOMPLETE_FRAMEBUFFER 0x" << std::hex << status << std::dec << std::endl;
+            return false;
+        }
+        glViewport(0, 0, width, height);
+        return true;
+    }
+    // ------------------------------------------------------------------------
+    void clear()
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        if (FBO)
+            glDeleteFramebuffers(1, &FBO);
+        if (colorBuffer)
+            glDeleteRenderbuffers(1, &colorBuffer);
+        if (depthBuffer)
+            glDeleteRenderbuffers(1, &depthBuffer);
+        FBO = colorBuffer = depthBuffer = 0;
+    }
+};
+
+#endif
@@ -0,0 +1,197 @@
+#pragma once
+//
+//  profiler.h
+//  3D Object Drawing
+//
+//  Scoped CPU profiling zones. PROFILE_ZONE("name") times the rest of the
+//  enclosing block and records thread, name, start and duration into a ring
+//  owned by the calling thread; only that thread writes it, so recording takes
+//  no lock. writeChromeTrace() turns every ring into Chrome trace-event JSON
+//  (chrome://tracing, ui.perfetto.dev). Zones compile to nothing in release
+//  builds unless PROFILER_IN_RELEASE is defined.
+//
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#if !defined(NDEBUG) || defined(PROFILER_IN_RELEASE)
+#define PROFILER_ENABLED 1
+#endif
+
+#include <string>
+#include <iostream>
+
+#ifdef PROFILER_ENABLED
+
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <cstddef>
+#include <cstdint>
+
+// events kept per thread; older ones are overwritten, so a trace holds the latest frames
+const size_t PROFILER_EVENTS_PER_THREAD = 1 << 16;
+
+struct ProfileEvent
+{
+    const char* name;       // a string literal, never copied
+    uint64_t startNs;       // since the profiler was first used
+    uint64_t durationNs;
+};
+
+struct ProfileThreadBuffer
+{
+    int thread;
+    std::vector<ProfileEvent> events;
+    std::atomic<size_t> written;    // total events recorded; the ring holds the last PROFILER_EVENTS_PER_THREAD
+
+    explicit ProfileThreadBuffer(int id) : thread(id), events(PROFILER_EVENTS_PER_THREAD), written(0)
+    {
+    }
+    // ------------------------------------------------------------------------
+    void record(const char* name, uint64_t startNs, uint64_t durationNs)
+    {
+        size_t n = written.load(std::memory_order_relaxed);
+        ProfileEvent& event = events[n % PROFILER_EVENTS_PER_THREAD];
+        event.name = name;
+        event.startNs = startNs;
+        event.durationNs = durationNs;
+        written.store(n + 1, std::memory_order_release);
+    }
+};
+
+class Profiler
+{
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    Profiler() : origin(Clock::now())
+    {
+    }
+    // ------------------------------------------------------------------------
+    uint64_t now() const
+    {
+        return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - origin).count();
+    }
+    // the calling thread's buffer, registered under the lock on its first zone only
+    // ------------------------------------------------------------------------
+    ProfileThreadBuffer& threadBuffer()
+    {
+        thread_local ProfileThreadBuffer* buffer = NULL;
+        if (!buffer)
+        {
+            std::lock_guard<std::mutex> lock(registry);
+            threads.push_back(std::unique_ptr<ProfileThreadBuffer>(new ProfileThreadBuffer((int)threads.size())));
+            buffer = threads.back().get();
+        }
+        return *buffer;
+    }
+    // writes every recorded zone as Chrome trace-event JSON; call while no other thread is recording
+    // ------------------------------------------------------------------------
+    bool writeChromeTrace(const std::string& path)
+    {
+        std::lock_guard<std::mutex> lock(registry);
+        std::ofstream file(path.c_str());
+        if (!file)
+        {
+            std::cout << "ERROR::PROFILER::TRACE_NOT_WRITTEN " << path << std::endl;
+            return false;
+        }
+        size_t total = 0, lost = 0;
+        file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+        bool first = true;
+        for (size_t t = 0; t < threads.size(); t++)
+        {
+            const ProfileThreadBuffer& buffer = *threads[t];
+            file << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer.thread
+                << ",\"args\":{\"name\":\"" << (buffer.thread == 0 ? "main" : "worker " + std::to_string(buffer.thread)) << "\"}}";
+            first = false;
+
+            size_t written = buffer.written.load(std::memory_order_acquire);
+            size_t begin = written > PROFILER_EVENTS_PER_THREAD ? written - PROFILER_EVENTS_PER_THREAD : 0;
+            lost += begin;
+            for (size_t i = begin; i < written; i++)
+            {
+                const ProfileEvent& event = buffer.events[i % PROFILER_EVENTS_PER_THREAD];
+                file << ",\n{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer.thread
+                    << ",\"ts\":" << event.startNs / 1000 << "." << pad3(event.startNs % 1000)
+                    << ",\"dur\":" << event.durationNs / 1000 << "." << pad3(event.durationNs % 1000) << "}";
+                total++;
+            }
+        }
+        file << "\n]}\n";
+        std::cout << "Profiler: " << total << " zones from " << threads.size() << " threads written to " << path;
+        if (lost > 0)
+            std::cout << " (" << lost << " older zones overwritten)";
+        std::cout << std::endl;
+        return (bool)file;
+    }
+
+private:
+    Clock::time_point origin;
+    std::mutex registry;
+    std::vector<std::unique_ptr<ProfileThreadBuffer>> threads;
+
+    static std::string pad3(uint64_t value)
+    {
+        std::string digits = std::to_string(value);
+        return std::string(3 - digits.size(), '0') + digits;
+    }
+};
+
+// ------------------------------------------------------------------------
+inline Profiler& profiler()
+{
+    static Profiler instance;
+    return instance;
+}
+
+// times its own lifetime
+class ProfileZone
+{
+public:
+    explicit ProfileZone(const char* zoneName) : name(zoneName), start(profiler().now())
+    {
+    }
+    ~ProfileZone()
+    {
+        Profiler& p = profiler();
+        uint64_t end = p.now();
+        p.threadBuffer().record(name, start, end - start);
+    }
+
+private:
+    const char* name;
+    uint64_t start;
+
+    ProfileZone(const ProfileZone&);
+    ProfileZone& operator=(const ProfileZone&);
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_ZONE(name) ProfileZone PROFILE_CONCAT(profileZone, __LINE__)(name)
+
+// ------------------------------------------------------------------------
+inline bool writeChromeTrace(const std::string& path)
+{
+    return profiler().writeChromeTrace(path);
+}
+
+#else
+
+#define PROFILE_ZONE(name) ((void)0)
+
+// ------------------------------------------------------------------------
+inline bool writeChromeTrace(const std::string& path)
+{
+    std::cout << "WARNING::PROFILER::DISABLED no zones in this build (define PROFILER_IN_RELEASE), " << path << " not written" << std::endl;
+    return false;
+}
+
+#endif
+
+#endif
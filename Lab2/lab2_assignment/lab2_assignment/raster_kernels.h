@@ -0,0 +1,333 @@
+#pragma once
+//
+//  raster_kernels.h
+//  3D Object Drawing
+//
+//  Inner loops of the software rasterizer, one 8x8 pixel block at a time:
+//  coverage from the edge functions that cross the block, and the depth test
+//  of the covered pixels. The AVX2 kernels handle a block row of 8 pixels per
+//  instruction, the SSE4.1 kernels half a row and the scalar kernels one
+//  pixel; all three give bit-identical results. The kernel is chosen once:
+//  AVX2 when glm/simd/platform.h reports that the compiler already targets it,
+//  otherwise whatever cpuid says this CPU runs, so one x86 build uses the
+//  widest kernel available.
+//
+
+#ifndef RASTER_KERNELS_H
+#define RASTER_KERNELS_H
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#define RASTER_KERNELS_X86 1
+#include <intrin.h>
+#include <immintrin.h>
+#define RASTER_TARGET(isa)
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define RASTER_KERNELS_X86 1
+#include <cpuid.h>
+#include <immintrin.h>
+#define RASTER_TARGET(isa) __attribute__((target(isa)))
+#endif
+
+// side of a block, in pixels; a block's pixel masks fit 64 bits
+const int RASTER_BLOCK = 8;
+
+enum RasterKernel
+{
+    RASTER_KERNEL_SCALAR,
+    RASTER_KERNEL_SSE41,
+    RASTER_KERNEL_AVX2
+};
+
+inline const char* rasterKernelName(RasterKernel kernel)
+{
+    switch (kernel)
+    {
+    case RASTER_KERNEL_AVX2: return "avx2";
+    case RASTER_KERNEL_SSE41: return "sse4.1";
+    default: return "scalar";
+    }
+}
+
+// the edges that cross one block, as 32-bit values at its first pixel center
+struct RasterBlockEdges
+{
+    int count;
+    int32_t value[3];           // bias included; a pixel is inside when every value is >= 0
+    int32_t stepX[3], stepY[3]; // per pixel
+};
+
+// window depth over a block: origin + dx * column + dy * row
+struct RasterBlockDepth
+{
+    float origin, dx, dy;
+};
+
+// bit (row * 8 + column) set for the first rows x columns pixels of a block
+inline uint64_t blockMask(int columns, int rows)
+{
+    uint64_t row = columns >= RASTER_BLOCK ? 0xFFull : (1ull << columns) - 1;
+    uint64_t mask = 0;
+    for (int r = 0; r < rows; r++)
+        mask |= row << (r * RASTER_BLOCK);
+    return mask;
+}
+
+// index of the lowest set bit; mask must not be 0
+inline int lowestBit(uint64_t mask)
+{
+#if defined(_MSC_VER) && defined(_M_X64)
+    unsigned long index;
+    _BitScanForward64(&index, mask);
+    return (int)index;
+#elif defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(mask);
+#else
+    int index = 0;
+    while (!(mask & 1))
+    {
+        mask >>= 1;
+        index++;
+    }
+    return index;
+#endif
+}
+
+// the widest kernel this CPU can run
+// ------------------------------------------------------------------------
+inline RasterKernel detectRasterKernel()
+{
+#if GLM_ARCH & GLM_ARCH_AVX2_BIT
+    return RASTER_KERNEL_AVX2;
+#elif defined(RASTER_KERNELS_X86)
+    unsigned int leaf1[4] = { 0, 0, 0, 0 }, leaf7[4] = { 0, 0, 0, 0 };
+    unsigned long long xcr0 = 0;
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    int maxLeaf = info[0];
+    __cpuid(info, 1);
+    for (int i = 0; i < 4; i++)
+        leaf1[i] = (unsigned int)info[i];
+    if (maxLeaf >= 7)
+    {
+        __cpuidex(info, 7, 0);
+        for (int i = 0; i < 4; i++)
+            leaf7[i] = (unsigned int)info[i];
+    }
+    if (leaf1[2] & (1u << 27))
+        xcr0 = _xgetbv(0);
+#else
+    unsigned int maxLeaf = __get_cpuid_max(0, NULL);
+    __cpuid(1, leaf1[0], leaf1[1], leaf1[2], leaf1[3]);
+    if (maxLeaf >= 7)
+        __cpuid_count(7, 0, leaf7[0], leaf7[1], leaf7[2], leaf7[3]);
+    if (leaf1[2] & (1u << 27))
+    {
+        unsigned int eax, edx;
+        __asm__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+        xcr0 = ((unsigned long long)edx << 32) | eax;
+    }
+#endif
+    // AVX2 also needs the OS to save the YMM registers
+    bool osSavesYMM = (xcr0 & 6) == 6;
+    if ((leaf7[1] & (1u << 5)) && (leaf1[2] & (1u << 28)) && osSavesYMM)
+        return RASTER_KERNEL_AVX2;
+    if (leaf1[2] & (1u << 19))
+        return RASTER_KERNEL_SSE41;
+    return RASTER_KERNEL_SCALAR;
+#else
+    return RASTER_KERNEL_SCALAR;
+#endif
+}
+
+// ------------------------------------------------------------------------
+inline uint64_t blockCoverageScalar(const RasterBlockEdges& edges, int columns, int rows)
+{
+    int32_t row[3] = { 0, 0, 0 }, stepX[3] = { 0, 0, 0 }, stepY[3] = { 0, 0, 0 };
+    for (int e = 0; e < edges.count; e++)
+    {
+        row[e] = edges.value[e];
+        stepX[e] = edges.stepX[e];
+        stepY[e] = edges.stepY[e];
+    }
+    uint64_t mask = 0;
+    for (int j = 0; j < rows; j++)
+    {
+        int32_t e0 = row[0], e1 = row[1], e2 = row[2];
+        for (int i = 0; i < columns; i++, e0 += stepX[0], e1 += stepX[1], e2 += stepX[2])
+            if ((e0 | e1 | e2) >= 0)
+                mask |= 1ull << (j * RASTER_BLOCK + i);
+        for (int e = 0; e < 3; e++)
+            row[e] += stepY[e];
+    }
+    return mask;
+}
+
+// depth test of the covered pixels of a block whose first depth value is at depth; returns the pixels that passed
+// ------------------------------------------------------------------------
+inline uint64_t blockDepthTestScalar(uint64_t covered, float* depth, size_t stride, const RasterBlockDepth& plane)
+{
+    uint64_t passed = 0;
+    for (uint64_t remaining = covered; remaining; remaining &= remaining - 1)
+    {
+        int bit = lowestBit(remaining);
+        int i = bit & (RASTER_BLOCK - 1), j = bit / RASTER_BLOCK;
+        float zRow = plane.origin + plane.dy * (float)j;
+        float z = zRow + plane.dx * (float)i;
+        float& d = depth[j * stride + i];
+        if (z < d)
+        {
+            d = z;
+            passed |= 1ull << bit;
+        }
+    }
+    return passed;
+}
+
+#ifdef RASTER_KERNELS_X86
+// four pixels per instruction: each block row in two halves
+// ------------------------------------------------------------------------
+RASTER_TARGET("sse4.1")
+inline uint64_t blockCoverageSSE41(const RasterBlockEdges& edges, int columns, int rows)
+{
+    const __m128i lanes = _mm_setr_epi32(0, 1, 2, 3);
+    __m128i left[3], right[3];
+    for (int e = 0; e < edges.count; e++)
+    {
+        __m128i offsets = _mm_mullo_epi32(_mm_set1_epi32(edges.stepX[e]), lanes);
+        left[e] = _mm_add_epi32(_mm_set1_epi32(edges.value[e]), offsets);
+        right[e] = _mm_add_epi32(left[e], _mm_set1_epi32(edges.stepX[e] * 4));
+    }
+    uint64_t mask = 0;
+    for (int j = 0; j < rows; j++)
+    {
+        // a pixel is outside when any edge value has its sign bit set
+        __m128i outLeft = _mm_setzero_si128(), outRight = _mm_setzero_si128();
+        for (int e = 0; e < edges.count; e++)
+        {
+            outLeft = _mm_or_si128(outLeft, left[e]);
+            outRight = _mm_or_si128(outRight, right[e]);
+            __m128i step = _mm_set1_epi32(edges.stepY[e]);
+            left[e] = _mm_add_epi32(left[e], step);
+            right[e] = _mm_add_epi32(right[e], step);
+        }
+        int outside = _mm_movemask_ps(_mm_castsi128_ps(outLeft)) | (_mm_movemask_ps(_mm_castsi128_ps(outRight)) << 4);
+        mask |= (uint64_t)(~outside & 0xFF) << (j * RASTER_BLOCK);
+    }
+    return mask & blockMask(columns, rows);
+}
+
+// full-width blocks only; narrower ones take the scalar test
+// ------------------------------------------------------------------------
+RASTER_TARGET("sse4.1")
+inline uint64_t blockDepthTestSSE41(uint64_t covered, float* depth, size_t stride, const RasterBlockDepth& plane)
+{
+    const __m128 dx = _mm_set1_ps(plane.dx);
+    const __m128 columnLeft = _mm_mul_ps(dx, _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f));
+    const __m128 columnRight = _mm_mul_ps(dx, _mm_setr_ps(4.0f, 5.0f, 6.0f, 7.0f));
+    uint64_t passed = 0;
+    for (int j = 0; j < RASTER_BLOCK; j++)
+    {
+        int rowCovered = (int)((covered >> (j * RASTER_BLOCK)) & 0xFF);
+        if (!rowCovered)
+            continue;
+        __m128 zRow = _mm_set1_ps(plane.origin + plane.dy * (float)j);
+        float* row = depth + j * stride;
+        __m128 zLeft = _mm_add_ps(zRow, columnLeft), zRight = _mm_add_ps(zRow, columnRight);
+        __m128 dLeft = _mm_loadu_ps(row), dRight = _mm_loadu_ps(row + 4);
+        int closer = _mm_movemask_ps(_mm_cmplt_ps(zLeft, dLeft)) | (_mm_movemask_ps(_mm_cmplt_ps(zRight, dRight)) << 4);
+        int pass = closer & rowCovered;
+        if (!pass)
+            continue;
+        static const int32_t laneBits[8] = { 1, 2, 4, 8, 16, 32, 64, 128 };
+        __m128i bits = _mm_set1_epi32(pass);
+        __m128 keepLeft = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(bits, _mm_loadu_si128((const __m128i*)laneBits)), _mm_loadu_si128((const __m128i*)laneBits)));
+        __m128 keepRight = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(bits, _mm_loadu_si128((const __m128i*)(laneBits + 4))), _mm_loadu_si128((const __m128i*)(laneBits + 4))));
+        _mm_storeu_ps(row, _mm_blendv_ps(dLeft, zLeft, keepLeft));
+        _mm_storeu_ps(row + 4, _mm_blendv_ps(dRight, zRight, keepRight));
+        passed |= (uint64_t)pass << (j * RASTER_BLOCK);
+    }
+    return passed;
+}
+
+// a whole block row per instruction
+// ------------------------------------------------------------------------
+RASTER_TARGET("avx2")
+inline uint64_t blockCoverageAVX2(const RasterBlockEdges& edges, int columns, int rows)
+{
+    const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    __m256i values[3];
+    for (int e = 0; e < edges.count; e++)
+        values[e] = _mm256_add_epi32(_mm256_set1_epi32(edges.value[e]), _mm256_mullo_epi32(_mm256_set1_epi32(edges.stepX[e]), lanes));
+    uint64_t mask = 0;
+    for (int j = 0; j < rows; j++)
+    {
+        __m256i outside = _mm256_setzero_si256();
+        for (int e = 0; e < edges.count; e++)
+        {
+            outside = _mm256_or_si256(outside, values[e]);
+            values[e] = _mm256_add_epi32(values[e], _mm256_set1_epi32(edges.stepY[e]));
+        }
+        mask |= (uint64_t)(~_mm256_movemask_ps(_mm256_castsi256_ps(outside)) & 0xFF) << (j * RASTER_BLOCK);
+    }
+    return mask & blockMask(columns, rows);
+}
+
+// full-width blocks only; narrower ones take the scalar test
+// ------------------------------------------------------------------------
+RASTER_TARGET("avx2")
+inline uint64_t blockDepthTestAVX2(uint64_t covered, float* depth, size_t stride, const RasterBlockDepth& plane)
+{
+    const __m256 columns = _mm256_mul_ps(_mm256_set1_ps(plane.dx), _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f));
+    const __m256i laneBits = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+    uint64_t passed = 0;
+    for (int j = 0; j < RASTER_BLOCK; j++)
+    {
+        int rowCovered = (int)((covered >> (j * RASTER_BLOCK)) & 0xFF);
+        if (!rowCovered)
+            continue;
+        float* row = depth + j * stride;
+        __m256 z = _mm256_add_ps(_mm256_set1_ps(plane.origin + plane.dy * (float)j), columns);
+        __m256 d = _mm256_loadu_ps(row);
+        int pass = _mm256_movemask_ps(_mm256_cmp_ps(z, d, _CMP_LT_OQ)) & rowCovered;
+        if (!pass)
+            continue;
+        __m256i keep = _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32(pass), laneBits), laneBits);
+        _mm256_storeu_ps(row, _mm256_blendv_ps(d, z, _mm256_castsi256_ps(keep)));
+        passed |= (uint64_t)pass << (j * RASTER_BLOCK);
+    }
+    return passed;
+}
+#endif
+
+// coverage of a block by the edges that cross it, limited to its first rows x columns pixels
+// ------------------------------------------------------------------------
+inline uint64_t blockCoverage(RasterKernel kernel, const RasterBlockEdges& edges, int columns, int rows)
+{
+#ifdef RASTER_KERNELS_X86
+    if (kernel == RASTER_KERNEL_AVX2)
+        return blockCoverageAVX2(edges, columns, rows);
+    if (kernel == RASTER_KERNEL_SSE41)
+        return blockCoverageSSE41(edges, columns, rows);
+#endif
+    return blockCoverageScalar(edges, columns, rows);
+}
+
+// ------------------------------------------------------------------------
+inline uint64_t blockDepthTest(RasterKernel kernel, uint64_t covered, float* depth, size_t stride, const RasterBlockDepth& plane, int columns)
+{
+#ifdef RASTER_KERNELS_X86
+    if (columns == RASTER_BLOCK && kernel == RASTER_KERNEL_AVX2)
+        return blockDepthTestAVX2(covered, depth, stride, plane);
+    if (columns == RASTER_BLOCK && kernel == RASTER_KERNEL_SSE41)
+        return blockDepthTestSSE41(covered, depth, stride, plane);
+#endif
+    return blockDepthTestScalar(covered, depth, stride, plane);
+}
+
+#endif
@@ -0,0 +1,570 @@
+#pragma once
+//
+//  scene_file.h
+//  3D Object Drawing
+//
+//  Scenes are written as text (.scene) and compiled once into a flat binary
+//  (.sceneb) that the program maps into memory and reads in place: a header,
+//  an array of fixed-size SceneNode records in depth-first order and a table
+//  of node names. Opening a scene is a map plus one validation pass, so its
+//  cost does not depend on parsing.
+//
+//  Text format, one node per line ('#' starts a comment):
+//
+//      <kind> <name> <parent> px py pz  rx ry rz  sx sy sz  [r g b a]  [flags]
+//
+//  kind     node (transform only), cube, or cylinder(segments,height,radius)
+//  name     unique name, or - for an unnamed node
+//  parent   name of a node declared earlier, or - for a root
+//  rx ry rz rotation in degrees, applied X then Y then Z
+//  r g b a  color; without it a primitive keeps its mesh's vertex colors
+//  flags    static    never moves relative to its anchor, the nearest non-static group
+//                     above it (a root, or e.g. a generated grid cell). Static primitives
+//                     are merged into their anchor's static batch, drawn and culled as one;
+//                     static groups may hold them, or anything else. Every node between a
+//                     static node and its anchor is a static group.
+//           occluder  also rasterized into the occlusion buffer
+//           spin      turned about Y by the fan angle, on top of its own rotation
+//
+//  Cubes are placed about CUBE_PIVOT exactly like addCube(); other kinds about
+//  their origin. The binary is native-endian and not meant to be portable.
+//
+
+#ifndef SCENE_FILE_H
+#define SCENE_FILE_H
+
+#include <glm/glm.hpp>
+
+#include "mesh_cache.h"
+#include "cube_renderer.h"
+#include "transform_hierarchy.h"
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <chrono>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+const uint32_t SCENE_MAGIC = 0x424E4353u;  // "SCNB"
+const uint32_t SCENE_VERSION = 1;
+const uint32_t SCENE_NO_NAME = 0xFFFFFFFFu;
+// primitive of a transform-only node
+const int32_t SCENE_GROUP = -1;
+
+enum SceneNodeFlags
+{
+    SCENE_STATIC = 1,
+    SCENE_OCCLUDER = 2,
+    SCENE_MESH_COLOR = 4,    // no color given: keep the mesh's vertex colors
+    SCENE_SPIN = 8
+};
+
+struct SceneHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t nodeCount;
+    uint32_t nameBytes;
+    uint64_t nodesOffset;
+    uint64_t namesOffset;
+};
+
+// one record of the binary; parent always has a smaller index than the node itself
+struct SceneNode
+{
+    uint32_t parent;        // NO_NODE for a root
+    uint32_t name;          // offset into the name table, or SCENE_NO_NAME
+    int32_t primitive;      // PrimitiveType, or SCENE_GROUP
+    uint32_t flags;         // SceneNodeFlags
+    int32_t segments;       // MeshKey parameters of the primitive
+    float height;
+    float radius;
+    float position[3];
+    float rotation[3];      // degrees
+    float scale[3];
+    float pivot[3];
+    float color[4];
+    uint32_t reserved;
+
+    glm::vec3 getPosition() const { return glm::vec3(position[0], position[1], position[2]); }
+    glm::vec3 getRotation() const { return glm::vec3(rotation[0], rotation[1], rotation[2]); }
+    glm::vec3 getScale() const { return glm::vec3(scale[0], scale[1], scale[2]); }
+    glm::vec3 getPivot() const { return glm::vec3(pivot[0], pivot[1], pivot[2]); }
+    glm::vec4 getColor() const { return glm::vec4(color[0], color[1], color[2], color[3]); }
+    MeshKey meshKey() const
+    {
+        MeshKey key = { (PrimitiveType)primitive, segments, height, radius };
+        return key;
+    }
+    // parent-relative model matrix
+    glm::mat4 localMatrix() const
+    {
+        return composeTRS(getPosition(), getRotation(), getScale(), getPivot());
+    }
+};
+
+static_assert(sizeof(SceneHeader) == 32, "SceneHeader layout is part of the file format");
+static_assert(sizeof(SceneNode) == 96, "SceneNode layout is part of the file format");
+
+// a parsed scene in memory; compileScene() writes it in the binary layout
+struct SceneSource
+{
+    std::vector<SceneNode> nodes;
+    std::vector<char> names;
+
+    uint32_t addName(const std::string& name)
+    {
+        uint32_t offset = (uint32_t)names.size();
+        names.insert(names.end(), name.begin(), name.end());
+        names.push_back('\0');
+        return offset;
+    }
+};
+
+// true when token is a complete floating-point number
+inline bool isSceneNumber(const std::string& token)
+{
+    char* end = NULL;
+    std::strtof(token.c_str(), &end);
+    return end != token.c_str() && *end == '\0';
+}
+
+// parses "cube", "node" or "cylinder(segments,height,radius)" into node
+// ------------------------------------------------------------------------
+inline bool parseSceneKind(const std::string& kind, SceneNode& node)
+{
+    node.segments = 0;
+    node.height = node.radius = 0.0f;
+    if (kind == "node")
+    {
+        node.primitive = SCENE_GROUP;
+        return true;
+    }
+    if (kind == "cube")
+    {
+        node.primitive = PRIMITIVE_CUBE;
+        return true;
+    }
+    int segments;
+    float height, radius;
+    if (std::sscanf(kind.c_str(), "cylinder(%d,%f,%f)", &segments, &height, &radius) == 3)
+    {
+        node.primitive = PRIMITIVE_CYLINDER;
+        node.segments = segments;
+        node.height = height;
+        node.radius = radius;
+        return true;
+    }
+    return false;
+}
+
+// reads a text scene; nodes come out in depth-first order with siblings in file order
+// ------------------------------------------------------------------------
+inline bool parseScene(const char* path, SceneSource& scene)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        std::cout << "ERROR::SCENE::FILE_NOT_FOUND " << path << std::endl;
+        return false;
+    }
+
+    std::vector<SceneNode> fileNodes;
+    std::vector<std::string> fileNames;
+    std::unordered_map<std::string, uint32_t> byName;
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line))
+    {
+        lineNumber++;
+        size_t comment = line.find('#');
+        if (comment != std::string::npos)
+            line.erase(comment);
+        std::istringstream tokens(line);
+        std::string kind, name, parent;
+        if (!(tokens >> kind))
+            continue;
+
+        SceneNode node;
+        std::memset(&node, 0, sizeof(node));
+        float* trs[3] = { node.position, node.rotation, node.scale };
+        bool ok = parseSceneKind(kind, node) && (tokens >> name >> parent);
+        for (int v = 0; v < 3 && ok; v++)
+            ok = (bool)(tokens >> trs[v][0] >> trs[v][1] >> trs[v][2]);
+        if (!ok)
+        {
+            std::cout << "ERROR::SCENE::PARSE_FAILED " << path << ":" << lineNumber << " expected <kind> <name> <parent> and 9 numbers" << std::endl;
+            return false;
+        }
+
+        // optional color, then flags
+        std::vector<std::string> rest;
+        std::string token;
+        while (tokens >> token)
+            rest.push_back(token);
+        size_t first = 0;
+        if (!rest.empty() && isSceneNumber(rest[0]))
+        {
+            if (rest.size() < 4)
+            {
+                std::cout << "ERROR::SCENE::PARSE_FAILED " << path << ":" << lineNumber << " color needs 4 components" << std::endl;
+                return false;
+            }
+            for (int c = 0; c < 4; c++)
+                node.color[c] = std::strtof(rest[c].c_str(), NULL);
+            first = 4;
+        }
+        else
+            node.flags |= SCENE_MESH_COLOR;
+        for (size_t i = first; i < rest.size(); i++)
+        {
+            if (rest[i] == "static")
+                node.flags |= SCENE_STATIC;
+            else if (rest[i] == "occluder")
+                node.flags |= SCENE_OCCLUDER;
+            else if (rest[i] == "spin")
+                node.flags |= SCENE_SPIN;
+            else
+            {
+                std::cout << "ERROR::SCENE::PARSE_FAILED " << path << ":" << lineNumber << " unknown flag " << rest[i] << std::endl;
+                return false;
+            }
+        }
+
+        glm::vec3 pivot = node.primitive == PRIMITIVE_CUBE ? CUBE_PIVOT : glm::vec3(0.0f);
+        node.pivot[0] = pivot.x; node.pivot[1] = pivot.y; node.pivot[2] = pivot.z;
+
+        node.parent = NO_NODE;
+        if (parent != "-")
+        {
+            std::unordered_map<std::string, uint32_t>::const_iterator it = byName.find(parent);
+            if (it == byName.end())
+            {
+                std::cout << "ERROR::SCENE::PARSE_FAILED " << path << ":" << lineNumber << " parent " << parent << " is not declared above" << std::endl;
+                return false;
+            }
+            node.parent = it->second;
+            const SceneNode& parentNode = fileNodes[node.parent];
+            if ((parentNode.flags & SCENE_STATIC) && parentNode.primitive != SCENE_GROUP)
+            {
+                std::cout << "ERROR::SCENE::PARSE_FAILED " << path << ":" << lineNumber << " static primitive " << parent << " cannot have children" << std::endl;
+                return false;
+            }
+        }
+        if ((node.flags & SCENE_STATIC) && (node.parent == NO_NODE ||
+            (fileNodes[node.parent].parent != NO_NODE && fileNodes[node.parent].primitive != SCENE_GROUP)))
+        {
+            std::cout << "ERROR::SCENE::PARSE_FAILED " << path << ":" << lineNumber << " static nodes need a root or a group as parent" << std::endl;
+            return false;
+        }
+        if ((node.flags & SCENE_STATIC) && (node.flags & SCENE_SPIN))
+        {
+            std::cout << "ERROR::SCENE::PARSE_FAILED " << path << ":" << lineNumber << " a node cannot be both static and spin" << std::endl;
+            return false;
+        }
+        if (name != "-" && !byName.insert(std::make_pair(name, (uint32_t)fileNodes.size())).second)
+        {
+            std::cout << "ERROR::SCENE::PARSE_FAILED " << path << ":" << lineNumber << " duplicate name " << name << std::endl;
+            return false;
+        }
+        fileNodes.push_back(node);
+        fileNames.push_back(name);
+    }
+
+    // reorder depth-first so TransformHierarchy can take the nodes as they are
+    size_t count = fileNodes.size();
+    std::vector<uint32_t> firstChild(count, NO_NODE), nextSibling(count, NO_NODE), lastChild(count, NO_NODE);
+    std::vector<uint32_t> roots;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        uint32_t p = fileNodes[i].parent;
+        if (p == NO_NODE)
+            roots.push_back(i);
+        else
+        {
+            if (lastChild[p] == NO_NODE)
+                firstChild[p] = i;
+            else
+                nextSibling[lastChild[p]] = i;
+            lastChild[p] = i;
+        }
+    }
+
+    scene.nodes.clear();
+    scene.names.clear();
+    scene.nodes.reserve(count);
+    std::vector<uint32_t> newIndex(count, NO_NODE);
+    std::vector<uint32_t> stack;
+    for (size_t r = roots.size(); r-- > 0;)
+        stack.push_back(roots[r]);
+    while (!stack.empty())
+    {
+        uint32_t i = stack.back();
+        stack.pop_back();
+        newIndex[i] = (uint32_t)scene.nodes.size();
+        SceneNode node = fileNodes[i];
+        if (node.parent != NO_NODE)
+            node.parent = newIndex[node.parent];
+        node.name = fileNames[i] == "-" ? SCENE_NO_NAME : scene.addName(fileNames[i]);
+        scene.nodes.push_back(node);
+
+        size_t top = stack.size();
+        for (uint32_t c = firstChild[i]; c != NO_NODE; c = nextSibling[c])
+            stack.push_back(c);
+        std::reverse(stack.begin() + top, stack.end());
+    }
+    return true;
+}
+
+// writes scene in the binary layout SceneFile maps
+// ------------------------------------------------------------------------
+inline bool writeScene(const char* path, const SceneSource& scene)
+{
+    SceneHeader header;
+    header.magic = SCENE_MAGIC;
+    header.version = SCENE_VERSION;
+    header.nodeCount = (uint32_t)scene.nodes.size();
+    header.nameBytes = (uint32_t)scene.names.size();
+    header.nodesOffset = sizeof(SceneHeader);
+    header.namesOffset = header.nodesOffset + scene.nodes.size() * sizeof(SceneNode);
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write((const char*)&header, sizeof(header));
+    if (!scene.nodes.empty())
+        file.write((const char*)scene.nodes.data(), scene.nodes.size() * sizeof(SceneNode));
+    if (!scene.names.empty())
+        file.write(scene.names.data(), scene.names.size());
+    if (!file)
+    {
+        std::cout << "ERROR::SCENE::WRITE_FAILED " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// text scene to binary scene
+// ------------------------------------------------------------------------
+inline bool compileScene(const char* textPath, const char* binaryPath)
+{
+    SceneSource scene;
+    if (!parseScene(textPath, scene) || !writeScene(binaryPath, scene))
+        return false;
+    std::cout << "Compiled " << textPath << " -> " << binaryPath << " (" << scene.nodes.size() << " nodes)" << std::endl;
+    return true;
+}
+
+// a compiled scene mapped read-only into memory
+class SceneFile
+{
+public:
+    double openMs = 0.0;
+
+    SceneFile() {}
+    SceneFile(const SceneFile&) = delete;
+    SceneFile& operator=(const SceneFile&) = delete;
+    ~SceneFile()
+    {
+        close();
+    }
+
+    // maps path and checks the header and parent order; on failure the scene stays empty
+    // ------------------------------------------------------------------------
+    bool open(const char* path)
+    {
+        close();
+        std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+        if (!map(path))
+        {
+            close();
+            std::cout << "ERROR::SCENE::MAP_FAILED " << path << std::endl;
+            return false;
+        }
+        if (!validate())
+        {
+            std::cout << "ERROR::SCENE::INVALID_FILE " << path << std::endl;
+            close();
+            return false;
+        }
+        openMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+        return true;
+    }
+    // ------------------------------------------------------------------------
+    void close()
+    {
+        unmap();
+        header = NULL;
+        nodeArray = NULL;
+        nameTable = NULL;
+    }
+    // ------------------------------------------------------------------------
+    uint32_t size() const
+    {
+        return header ? header->nodeCount : 0;
+    }
+    const SceneNode* nodes() const
+    {
+        return nodeArray;
+    }
+    const SceneNode& node(uint32_t index) const
+    {
+        return nodeArray[index];
+    }
+    // "" for unnamed nodes
+    const char* name(uint32_t index) const
+    {
+        uint32_t offset = nodeArray[index].name;
+        return offset == SCENE_NO_NAME ? "" : nameTable + offset;
+    }
+    // index of the node called name, or NO_NODE
+    // ------------------------------------------------------------------------
+    uint32_t find(const char* nodeName) const
+    {
+        for (uint32_t i = 0; i < size(); i++)
+            if (nodeArray[i].name != SCENE_NO_NAME && std::strcmp(nameTable + nodeArray[i].name, nodeName) == 0)
+                return i;
+        return NO_NODE;
+    }
+    size_t bytes() const
+    {
+        return mappedSize;
+    }
+
+private:
+    const SceneHeader* header = NULL;
+    const SceneNode* nodeArray = NULL;
+    const char* nameTable = NULL;
+    const void* mapped = NULL;
+    size_t mappedSize = 0;
+#ifdef _WIN32
+    HANDLE fileHandle = INVALID_HANDLE_VALUE;
+    HANDLE mappingHandle = NULL;
+#endif
+
+    // ------------------------------------------------------------------------
+    bool validate()
+    {
+        if (mappedSize < sizeof(SceneHeader))
+            return false;
+        header = (const SceneHeader*)mapped;
+        if (header->magic != SCENE_MAGIC || header->version != SCENE_VERSION)
+            return false;
+        uint64_t nodesEnd = header->nodesOffset + (uint64_t)header->nodeCount * sizeof(SceneNode);
+        if (header->nodesOffset % 4 != 0 || nodesEnd > header->namesOffset || header->namesOffset + header->nameBytes > mappedSize)
+            return false;
+        if (header->nameBytes > 0 && ((const char*)mapped)[header->namesOffset + header->nameBytes - 1] != '\0')
+            return false;
+        nodeArray = (const SceneNode*)((const char*)mapped + header->nodesOffset);
+        nameTable = (const char*)mapped + header->namesOffset;
+        for (uint32_t i = 0; i < header->nodeCount; i++)
+        {
+            const SceneNode& node = nodeArray[i];
+            if ((node.parent != NO_NODE && node.parent >= i) || (node.name != SCENE_NO_NAME && node.name >= header->nameBytes))
+                return false;
+        }
+        return true;
+    }
+
+#ifdef _WIN32
+    bool map(const char* path)
+    {
+        fileHandle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (fileHandle == INVALID_HANDLE_VALUE)
+            return false;
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(fileHandle, &fileSize) || fileSize.QuadPart == 0)
+            return false;
+        mappingHandle = CreateFileMappingA(fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (!mappingHandle)
+            return false;
+        mapped = MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+        mappedSize = (size_t)fileSize.QuadPart;
+        return mapped != NULL;
+    }
+    void unmap()
+    {
+        if (mapped)
+            UnmapViewOfFile(mapped);
+        if (mappingHandle)
+            CloseHandle(mappingHandle);
+        if (fileHandle != INVALID_HANDLE_VALUE)
+            CloseHandle(fileHandle);
+        mapped = NULL;
+        mappedSize = 0;
+        mappingHandle = NULL;
+        fileHandle = INVALID_HANDLE_VALUE;
+    }
+#else
+    bool map(const char* path)
+    {
+        int fd = ::open(path, O_RDONLY);
+        if (fd < 0)
+            return false;
+        struct stat info;
+        if (fstat(fd, &info) != 0 || info.st_size == 0)
+        {
+            ::close(fd);
+            return false;
+        }
+        void* view = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);    // the mapping keeps the file alive
+        if (view == MAP_FAILED)
+            return false;
+        mapped = view;
+        mappedSize = (size_t)info.st_size;
+        return true;
+    }
+    void unmap()
+    {
+        if (mapped)
+            munmap((void*)mapped, mappedSize);
+        mapped = NULL;
+        mappedSize = 0;
+    }
+#endif
+};
+
+// opens a scene by path; a text scene is compiled to "<path>b" first whenever that file is
+// missing or older than the text
+// ------------------------------------------------------------------------
+inline bool loadScene(const std::string& path, SceneFile& scene)
+{
+    const std::string extension = ".scene";
+    if (path.size() < extension.size() || path.compare(path.size() - extension.size(), extension.size(), extension) != 0)
+        return scene.open(path.c_str());
+
+    std::string binaryPath = path + "b";
+    struct stat text, binary;
+    if (stat(path.c_str(), &text) != 0)
+    {
+        std::cout << "ERROR::SCENE::FILE_NOT_FOUND " << path << std::endl;
+        return false;
+    }
+    if (stat(binaryPath.c_str(), &binary) != 0 || binary.st_mtime < text.st_mtime)
+        if (!compileScene(path.c_str(), binaryPath.c_str()))
+            return false;
+    return scene.open(binaryPath.c_str());
+}
+
+#endif
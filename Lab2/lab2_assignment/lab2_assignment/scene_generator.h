@@ -0,0 +1,133 @@
+#pragma once
+//
+//  scene_generator.h
+//  3D Object Drawing
+//
+//  Stress scenes built from the room layout: the template scene is copied into
+//  a columns x rows grid of cells under its own root, so the result loads and
+//  renders through exactly the same path as the single room. Every copy gets
+//  its own fan phase and, from a seeded generator, slightly shifted furniture
+//  (the static groups directly under the root) and jittered colors.
+//
+
+#ifndef SCENE_GENERATOR_H
+#define SCENE_GENERATOR_H
+
+#include "scene_file.h"
+
+#include <string>
+#include <vector>
+#include <random>
+#include <iostream>
+#include <algorithm>
+#include <cstdio>
+
+struct RoomGridOptions
+{
+    int columns = 1;
+    int rows = 1;
+    float spacingX = 8.0f;      // cell pitch; the room spans 6 x 7 units between its walls
+    float spacingZ = 9.0f;
+    unsigned int seed = 4208;
+    float furnitureOffset = 0.15f;  // furniture moves up to this far along X and Z
+    float colorJitter = 0.1f;       // colors are scaled by up to 1 +/- this
+};
+
+// parses "<columns>x<rows>"
+// ------------------------------------------------------------------------
+inline bool parseGridSize(const char* text, RoomGridOptions& options)
+{
+    int columns, rows;
+    if (std::sscanf(text, "%dx%d", &columns, &rows) != 2 || columns < 1 || rows < 1)
+    {
+        std::cout << "ERROR::SCENE_GENERATOR::BAD_GRID_SIZE " << text << " (expected e.g. 10x10)" << std::endl;
+        return false;
+    }
+    options.columns = columns;
+    options.rows = rows;
+    return true;
+}
+
+// copies the single-root scene room into a grid of cells; cell (0, 0) of a 1x1 grid without
+// variation reproduces room exactly
+// ------------------------------------------------------------------------
+inline bool generateRoomGrid(const SceneSource& room, const RoomGridOptions& options, SceneSource& grid)
+{
+    if (room.nodes.empty() || room.nodes[0].parent != NO_NODE ||
+        std::count_if(room.nodes.begin(), room.nodes.end(), [](const SceneNode& n) { return n.parent == NO_NODE; }) != 1)
+    {
+        std::cout << "ERROR::SCENE_GENERATOR::TEMPLATE_NEEDS_ONE_ROOT" << std::endl;
+        return false;
+    }
+
+    std::mt19937 rng(options.seed);
+    std::uniform_real_distribution<float> offset(-options.furnitureOffset, options.furnitureOffset);
+    std::uniform_real_distribution<float> jitter(1.0f - options.colorJitter, 1.0f + options.colorJitter);
+    std::uniform_real_distribution<float> phase(0.0f, 360.0f);
+
+    grid.nodes.clear();
+    grid.names.clear();
+    grid.nodes.reserve(1 + (size_t)options.columns * options.rows * room.nodes.size());
+
+    SceneNode root = room.nodes[0];
+    root.name = room.nodes[0].name == SCENE_NO_NAME ? SCENE_NO_NAME : grid.addName(&room.names[room.nodes[0].name]);
+    grid.nodes.push_back(root);
+
+    std::vector<uint32_t> copied(room.nodes.size());
+    char suffix[32];
+    for (int row = 0; row < options.rows; row++)
+        for (int column = 0; column < options.columns; column++)
+        {
+            std::snprintf(suffix, sizeof(suffix), "_%d_%d", column, row);
+
+            // the cell is a plain group centered on the grid; not being static, it anchors its own
+            // static batch, so each room is drawn and culled on its own
+            SceneNode cell;
+            std::memset(&cell, 0, sizeof(cell));
+            cell.parent = 0;
+            cell.primitive = SCENE_GROUP;
+            cell.flags = 0;
+            cell.position[0] = (column - (options.columns - 1) * 0.5f) * options.spacingX;
+            cell.position[2] = (row - (options.rows - 1) * 0.5f) * options.spacingZ;
+            cell.scale[0] = cell.scale[1] = cell.scale[2] = 1.0f;
+            cell.name = grid.addName(std::string("cell") + suffix);
+            copied[0] = (uint32_t)grid.nodes.size();
+            grid.nodes.push_back(cell);
+
+            for (size_t i = 1; i < room.nodes.size(); i++)
+            {
+                SceneNode node = room.nodes[i];
+                bool furniture = node.parent == 0 && node.primitive == SCENE_GROUP && (node.flags & SCENE_STATIC);
+                node.parent = copied[node.parent];
+                if (node.name != SCENE_NO_NAME)
+                    node.name = grid.addName(std::string(&room.names[node.name]) + suffix);
+                if (furniture)
+                {
+                    node.position[0] += offset(rng);
+                    node.position[2] += offset(rng);
+                }
+                if (!(node.flags & SCENE_MESH_COLOR))
+                    for (int c = 0; c < 3; c++)
+                        node.color[c] = std::min(1.0f, node.color[c] * jitter(rng));
+                if (node.flags & SCENE_SPIN)
+                    node.rotation[1] += phase(rng);
+                copied[i] = (uint32_t)grid.nodes.size();
+                grid.nodes.push_back(node);
+            }
+        }
+    return true;
+}
+
+// parses templatePath, tiles it and writes the compiled grid to outputPath
+// ------------------------------------------------------------------------
+inline bool generateRoomGridFile(const char* templatePath, const RoomGridOptions& options, const char* outputPath)
+{
+    SceneSource room, grid;
+    if (!parseScene(templatePath, room) || !generateRoomGrid(room, options, grid) || !writeScene(outputPath, grid))
+        return false;
+    std::cout << "Generated " << options.columns << "x" << options.rows << " rooms from " << templatePath << " -> "
+        << outputPath << " (" << grid.nodes.size() << " nodes, seed " << options.seed << ")" << std::endl;
+    return true;
+}
+
+#endif
@@ -12,19 +12,45 @@
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
+#include "gl_state_cache.h"
+#include "profiler.h"
+
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <unordered_map>
+
+// pre-resolved uniform location; T is the C++ type the uniform is set from
+template <typename T>
+struct UniformHandle
+{
+    GLint location = -1;
+
+    bool valid() const { return location != -1; }
+};
+
+typedef UniformHandle<bool> UniformBool;
+typedef UniformHandle<int> UniformInt;
+typedef UniformHandle<float> UniformFloat;
+typedef UniformHandle<glm::vec2> UniformVec2;
+typedef UniformHandle<glm::vec3> UniformVec3;
+typedef UniformHandle<glm::vec4> UniformVec4;
+typedef UniformHandle<glm::mat2> UniformMat2;
+typedef UniformHandle<glm::mat3> UniformMat3;
+typedef UniformHandle<glm::mat4> UniformMat4;
 
 class Shader
 {
 public:
     unsigned int ID;
+    // number of lookups of names that are not active uniforms of this program
+    mutable size_t missingUniformLookups = 0;
     // constructor generates the shader on the fly
     // ------------------------------------------------------------------------
     Shader(const char* vertexPath, const char* fragmentPath)
     {
+        PROFILE_ZONE("Shader::Shader");
         // 1. retrieve the vertex/fragment source code from filePath
         std::string vertexCode;
         std::string fragmentCode;
@@ -76,74 +102,176 @@ public:
         // delete the shaders as they're linked into our program now and no longer necessary
         glDeleteShader(vertex);
         glDeleteShader(fragment);
-
+        // resolve every active uniform once so setters never query the driver
+        cacheUniforms();
     }
     // activate the shader
     // ------------------------------------------------------------------------
     void use() const
     {
-        glUseProgram(ID);
+        glState().useProgram(ID);
+    }
+    // attach a uniform block of this program to a buffer binding point
+    // ------------------------------------------------------------------------
+    bool bindUniformBlock(const std::string& blockName, GLuint binding) const
+    {
+        GLuint index = glGetUniformBlockIndex(ID, blockName.c_str());
+        if (index == GL_INVALID_INDEX)
+        {
+            std::cout << "WARNING::SHADER::UNIFORM_BLOCK_NOT_FOUND: " << blockName << std::endl;
+            return false;
+        }
+        glUniformBlockBinding(ID, index, binding);
+        return true;
+    }
+    // cached location of a uniform, -1 (and counted) if the program has no such uniform
+    // ------------------------------------------------------------------------
+    GLint location(const std::string& name) const
+    {
+        std::unordered_map<std::string, GLint>::const_iterator it = uniformLocations.find(name);
+        if (it != uniformLocations.end() && it->second != -1)
+            return it->second;
+
+        missingUniformLookups++;
+        if (it == uniformLocations.end())
+        {
+            // report each unknown name once, then remember it as missing
+            std::cout << "WARNING::SHADER::UNIFORM_NOT_FOUND: " << name << std::endl;
+            uniformLocations[name] = -1;
+        }
+        return -1;
+    }
+    // typed handle for hot paths: resolve once, then set without any string work
+    // ------------------------------------------------------------------------
+    template <typename T>
+    UniformHandle<T> uniform(const std::string& name) const
+    {
+        UniformHandle<T> handle;
+        handle.location = location(name);
+        return handle;
+    }
+    // ------------------------------------------------------------------------
+    void set(UniformBool handle, bool value) const
+    {
+        glUniform1i(handle.location, (int)value);
+    }
+    void set(UniformInt handle, int value) const
+    {
+        glUniform1i(handle.location, value);
+    }
+    void set(UniformFloat handle, float value) const
+    {
+        glUniform1f(handle.location, value);
+    }
+    void set(UniformVec2 handle, const glm::vec2& value) const
+    {
+        glUniform2fv(handle.location, 1, &value[0]);
+    }
+    void set(UniformVec3 handle, const glm::vec3& value) const
+    {
+        glUniform3fv(handle.location, 1, &value[0]);
+    }
+    void set(UniformVec4 handle, const glm::vec4& value) const
+    {
+        glUniform4fv(handle.location, 1, &value[0]);
+    }
+    void set(UniformMat2 handle, const glm::mat2& mat) const
+    {
+        glUniformMatrix2fv(handle.location, 1, GL_FALSE, &mat[0][0]);
+    }
+    void set(UniformMat3 handle, const glm::mat3& mat) const
+    {
+        glUniformMatrix3fv(handle.location, 1, GL_FALSE, &mat[0][0]);
+    }
+    void set(UniformMat4 handle, const glm::mat4& mat) const
+    {
+        glUniformMatrix4fv(handle.location, 1, GL_FALSE, &mat[0][0]);
     }
     // utility uniform functions
     // ------------------------------------------------------------------------
     void setBool(const std::string& name, bool value) const
     {
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+        glUniform1i(location(name), (int)value);
     }
     // ------------------------------------------------------------------------
     void setInt(const std::string& name, int value) const
     {
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+        glUniform1i(location(name), value);
     }
     // ------------------------------------------------------------------------
     void setFloat(const std::string& name, float value) const
     {
-        glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+        glUniform1f(location(name), value);
     }
     // ------------------------------------------------------------------------
     void setVec2(const std::string& name, const glm::vec2& value) const
     {
-        glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        glUniform2fv(location(name), 1, &value[0]);
     }
     void setVec2(const std::string& name, float x, float y) const
     {
-        glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y);
+        glUniform2f(location(name), x, y);
     }
     // ------------------------------------------------------------------------
     void setVec3(const std::string& name, const glm::vec3& value) const
     {
-        glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        glUniform3fv(location(name), 1, &value[0]);
     }
     void setVec3(const std::string& name, float x, float y, float z) const
     {
-        glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z);
+        glUniform3f(location(name), x, y, z);
     }
     // ------------------------------------------------------------------------
     void setVec4(const std::string& name, const glm::vec4& value) const
     {
-        glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        glUniform4fv(location(name), 1, &value[0]);
     }
     void setVec4(const std::string& name, float x, float y, float z, float w) const
     {
-        glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w);
+        glUniform4f(location(name), x, y, z, w);
     }
     // ------------------------------------------------------------------------
     void setMat2(const std::string& name, const glm::mat2& mat) const
     {
-        glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix2fv(location(name), 1, GL_FALSE, &mat[0][0]);
     }
     // ------------------------------------------------------------------------
     void setMat3(const std::string& name, const glm::mat3& mat) const
     {
-        glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix3fv(location(name), 1, GL_FALSE, &mat[0][0]);
     }
     // ------------------------------------------------------------------------
     void setMat4(const std::string& name, const glm::mat4& mat) const
     {
-        glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix4fv(location(name), 1, GL_FALSE, &mat[0][0]);
     }
 
 private:
+    mutable std::unordered_map<std::string, GLint> uniformLocations;
+
+    // query all active uniforms after link (block members have no location and are skipped)
+    // ------------------------------------------------------------------------
+    void cacheUniforms()
+    {
+        GLint count = 0;
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+        for (GLint i = 0; i < count; i++)
+        {
+            GLchar name[256];
+            GLsizei length = 0;
+            GLint size = 0;
+            GLenum type = 0;
+            glGetActiveUniform(ID, (GLuint)i, sizeof(name), &length, &size, &type, name);
+            GLint loc = glGetUniformLocation(ID, name);
+            if (loc == -1)
+                continue;
+            std::string uniformName(name, length);
+            uniformLocations[uniformName] = loc;
+            // arrays are reported as "name[0]"; also accept the bare name
+            if (uniformName.size() > 3 && uniformName.compare(uniformName.size() - 3, 3, "[0]") == 0)
+                uniformLocations[uniformName.substr(0, uniformName.size() - 3)] = loc;
+        }
+    }
     // utility function for checking shader compilation/linking errors.
     // ------------------------------------------------------------------------
     void checkCompileErrors(GLuint shader, std::string type)
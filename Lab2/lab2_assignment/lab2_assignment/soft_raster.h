@@ -0,0 +1,510 @@
+#pragma once
+//
+//  soft_raster.h
+//  3D Object Drawing
+//
+//  Software rendering backend for machines without a GPU. drawIndexed() runs
+//  the vertex stage of vertexShader.vs (viewProjection * model * position,
+//  vertex or instance color) and queues the triangles; finish() clips them
+//  against the view volume, snaps them to 1/16 pixel, bins them into 64x64
+//  pixel tiles and rasterizes every tile on a worker pool. Each tile is owned
+//  by one thread and walks its triangles in submission order, so the image is
+//  the same for any thread count. Triangles are walked in 8x8 blocks that are
+//  rejected or accepted whole where possible, with the rest handed to the
+//  kernels of raster_kernels.h. Coverage follows a top-left style rule that
+//  never draws a shared edge twice, depth is tested with GL_LESS and color is
+//  interpolated perspective-correctly, as the GL pipeline does.
+//
+
+#ifndef SOFT_RASTER_H
+#define SOFT_RASTER_H
+
+#include <glm/glm.hpp>
+
+#include "image_io.h"
+#include "worker_pool.h"
+#include "profiler.h"
+#include "raster_kernels.h"
+
+#include <vector>
+#include <chrono>
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <cstddef>
+#include <cstdint>
+
+// side of a screen tile, in pixels
+const int SOFT_RASTER_TILE = 64;
+// sub-pixel precision of snapped vertex positions
+const int SOFT_RASTER_SUBPIXEL_BITS = 4;
+const int SOFT_RASTER_SUBPIXEL = 1 << SOFT_RASTER_SUBPIXEL_BITS;
+// largest target side, so snapped coordinates and edge values stay in range
+const int SOFT_RASTER_MAX_SIZE = 8192;
+// triangles set up and binned by one job
+const size_t SOFT_RASTER_BIN_CHUNK = 1024;
+// vertices transformed by one job of a large draw
+const size_t SOFT_RASTER_VERTEX_CHUNK = 4096;
+
+// a vertex after the vertex stage
+struct SoftVertex
+{
+    glm::vec4 clip;
+    glm::vec3 color;
+};
+
+// a clipped triangle in snapped window coordinates, y down, wound so that area > 0
+struct SoftTriangle
+{
+    int32_t x[3], y[3];             // sub-pixel units
+    float z[3];                     // window depth, 0 near to 1 far
+    float invW[3];
+    glm::vec3 colorOverW[3];
+    int minX, minY, maxX, maxY;     // pixels whose centers may be covered, inclusive
+    int64_t area;                   // twice the area, in sub-pixel units squared
+};
+
+class SoftwareRasterizer
+{
+public:
+    int width = 0, height = 0;
+    Image color;                    // top row first, like the images read back from GL
+    std::vector<float> depth;
+    RasterKernel kernel = RASTER_KERNEL_SCALAR;     // coverage and depth kernel; init() picks the widest
+    // per-frame counters, accumulated into the totals by finish()
+    size_t draws = 0;
+    size_t triangles = 0;           // submitted
+    size_t binned = 0;              // left after clipping with pixels to cover
+    size_t pixels = 0;              // fragments that passed the depth test
+    double vertexMs = 0.0, binMs = 0.0, rasterMs = 0.0;
+    size_t frames = 0;
+    size_t totalTriangles = 0;
+    size_t totalPixels = 0;
+    double totalVertexMs = 0.0, totalBinMs = 0.0, totalRasterMs = 0.0;
+
+    // threadCount counts the calling thread; 0 uses every core
+    // ------------------------------------------------------------------------
+    bool init(int targetWidth, int targetHeight, unsigned int threadCount = 0)
+    {
+        if (targetWidth <= 0 || targetHeight <= 0 || targetWidth > SOFT_RASTER_MAX_SIZE || targetHeight > SOFT_RASTER_MAX_SIZE)
+        {
+            std::cout << "ERROR::SOFT_RASTER::BAD_SIZE " << targetWidth << "x" << targetHeight
+                << " (at most " << SOFT_RASTER_MAX_SIZE << " a side)" << std::endl;
+            return false;
+        }
+        width = targetWidth;
+        height = targetHeight;
+        color.resize(width, height);
+        depth.assign((size_t)width * height, 1.0f);
+        tilesX = (width + SOFT_RASTER_TILE - 1) / SOFT_RASTER_TILE;
+        tilesY = (height + SOFT_RASTER_TILE - 1) / SOFT_RASTER_TILE;
+        tilePixels.assign((size_t)tilesX * tilesY, 0);
+        chunks.clear();
+        kernel = detectRasterKernel();
+        workers.stop();
+        if (threadCount != 1)
+            workers.start(threadCount > 1 ? threadCount - 1 : 0);
+        return true;
+    }
+    // clears color and depth and starts a new frame
+    // ------------------------------------------------------------------------
+    void beginFrame(const glm::vec4& clearColor)
+    {
+        uint8_t rgba[4];
+        for (int c = 0; c < 4; c++)
+            rgba[c] = toByte(clearColor[c]);
+        uint32_t packed;
+        std::memcpy(&packed, rgba, 4);
+        uint32_t* dst = (uint32_t*)color.rgba.data();
+        std::fill(dst, dst + (size_t)width * height, packed);
+        std::fill(depth.begin(), depth.end(), 1.0f);
+        vertices.clear();
+        indices.clear();
+        draws = triangles = binned = pixels = 0;
+        vertexMs = binMs = rasterMs = 0.0;
+    }
+    // queues an indexed triangle mesh (6 floats per vertex, position then color) placed by model;
+    // color, if given, replaces the vertex colors as the instance color does
+    // ------------------------------------------------------------------------
+    void drawIndexed(const std::vector<float>& meshVertices, const std::vector<unsigned int>& meshIndices,
+        const glm::mat4& model, const glm::mat4& viewProjection, const glm::vec4* instanceColor = NULL)
+    {
+        Clock::time_point start = Clock::now();
+        glm::mat4 toClip = viewProjection * model;
+        size_t base = vertices.size(), count = meshVertices.size() / 6;
+        vertices.resize(base + count);
+        auto transform = [&](size_t chunk) {
+            size_t end = std::min(count, (chunk + 1) * SOFT_RASTER_VERTEX_CHUNK);
+            for (size_t v = chunk * SOFT_RASTER_VERTEX_CHUNK; v < end; v++)
+            {
+                const float* src = &meshVertices[v * 6];
+                SoftVertex& out = vertices[base + v];
+                out.clip = toClip * glm::vec4(src[0], src[1], src[2], 1.0f);
+                out.color = instanceColor ? glm::vec3(*instanceColor) : glm::vec3(src[3], src[4], src[5]);
+            }
+        };
+        size_t vertexChunks = (count + SOFT_RASTER_VERTEX_CHUNK - 1) / SOFT_RASTER_VERTEX_CHUNK;
+        if (vertexChunks > 1)
+            workers.parallelFor(vertexChunks, transform);
+        else if (vertexChunks == 1)
+            transform(0);
+
+        size_t first = indices.size(), triangleIndices = meshIndices.size() / 3 * 3;
+        indices.resize(first + triangleIndices);
+        for (size_t i = 0; i < triangleIndices; i++)
+            indices[first + i] = (uint32_t)(base + meshIndices[i]);
+        draws++;
+        triangles += triangleIndices / 3;
+        vertexMs += elapsedMs(start);
+    }
+    // sets up, bins and rasterizes everything queued since beginFrame()
+    // ------------------------------------------------------------------------
+    void finish()
+    {
+        PROFILE_ZONE("SoftwareRasterizer::finish");
+        Clock::time_point start = Clock::now();
+        size_t triangleCount = indices.size() / 3;
+        size_t chunkCount = (triangleCount + SOFT_RASTER_BIN_CHUNK - 1) / SOFT_RASTER_BIN_CHUNK;
+        if (chunks.size() < chunkCount)
+            chunks.resize(chunkCount);
+        workers.parallelFor(chunkCount, [&](size_t c) { binChunk(c, triangleCount); });
+        for (size_t c = 0; c < chunkCount; c++)
+            binned += chunks[c].triangles.size();
+        Clock::time_point binEnd = Clock::now();
+        binMs += std::chrono::duration<double, std::milli>(binEnd - start).count();
+
+        workers.parallelFor(tilePixels.size(), [&](size_t tile) { rasterizeTile(tile, chunkCount); });
+        for (size_t t = 0; t < tilePixels.size(); t++)
+            pixels += tilePixels[t];
+        rasterMs += elapsedMs(binEnd);
+
+        frames++;
+        totalTriangles += triangles;
+        totalPixels += pixels;
+        totalVertexMs += vertexMs;
+        totalBinMs += binMs;
+        totalRasterMs += rasterMs;
+    }
+    // ------------------------------------------------------------------------
+    void printStats() const
+    {
+        size_t n = frames > 0 ? frames : 1;
+        double ms = totalVertexMs + totalBinMs + totalRasterMs;
+        double seconds = ms > 0.0 ? ms / 1000.0 : 1.0;
+        std::cout << "SoftwareRasterizer: " << width << "x" << height << " on " << threads() << " threads with the "
+            << rasterKernelName(kernel) << " kernel, "
+            << totalTriangles / n << " triangles and " << totalPixels / n << " pixels per frame; vertex "
+            << totalVertexMs / n << " ms, bin " << totalBinMs / n << " ms, raster " << totalRasterMs / n << " ms per frame ("
+            << totalTriangles / seconds / 1.0e6 << " Mtri/s, " << totalPixels / seconds / 1.0e6 << " Mpixel/s)" << std::endl;
+    }
+    // ------------------------------------------------------------------------
+    size_t threads() const
+    {
+        return workers.size() + 1;
+    }
+    // ------------------------------------------------------------------------
+    void clear()
+    {
+        workers.stop();
+        vertices.clear();
+        indices.clear();
+        chunks.clear();
+    }
+
+private:
+    typedef std::chrono::high_resolution_clock Clock;
+
+    // the triangles of one bin job and, per tile, which of them touch it
+    struct BinChunk
+    {
+        std::vector<SoftTriangle> triangles;
+        std::vector<std::vector<uint32_t>> bins;
+    };
+
+    std::vector<SoftVertex> vertices;
+    std::vector<uint32_t> indices;
+    std::vector<BinChunk> chunks;
+    std::vector<size_t> tilePixels;
+    int tilesX = 0, tilesY = 0;
+    WorkerPool workers;
+
+    static double elapsedMs(Clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+    static uint8_t toByte(float value)
+    {
+        return (uint8_t)(std::min(std::max(value, 0.0f), 1.0f) * 255.0f + 0.5f);
+    }
+
+    // ------------------------------------------------------------------------
+    void binChunk(size_t c, size_t triangleCount)
+    {
+        BinChunk& chunk = chunks[c];
+        chunk.triangles.clear();
+        chunk.bins.resize(tilePixels.size());
+        for (size_t t = 0; t < chunk.bins.size(); t++)
+            chunk.bins[t].clear();
+        size_t end = std::min(triangleCount, (c + 1) * SOFT_RASTER_BIN_CHUNK);
+        for (size_t t = c * SOFT_RASTER_BIN_CHUNK; t < end; t++)
+            clipTriangle(vertices[indices[t * 3]], vertices[indices[t * 3 + 1]], vertices[indices[t * 3 + 2]], chunk);
+    }
+
+    // planes of the view volume as distances that are >= 0 inside
+    static float planeDistance(const glm::vec4& p, int plane)
+    {
+        switch (plane)
+        {
+        case 0: return p.w + p.x;
+        case 1: return p.w - p.x;
+        case 2: return p.w + p.y;
+        case 3: return p.w - p.y;
+        case 4: return p.w + p.z;
+        default: return p.w - p.z;
+        }
+    }
+    static int outcode(const glm::vec4& p)
+    {
+        int code = 0;
+        for (int plane = 0; plane < 6; plane++)
+            if (planeDistance(p, plane) < 0.0f)
+                code |= 1 << plane;
+        return code;
+    }
+
+    // triangles inside the view volume go straight to setup; the rest are clipped to a fan
+    // ------------------------------------------------------------------------
+    void clipTriangle(const SoftVertex& a, const SoftVertex& b, const SoftVertex& c, BinChunk& chunk)
+    {
+        int ca = outcode(a.clip), cb = outcode(b.clip), cc = outcode(c.clip);
+        if (ca & cb & cc)
+            return;
+        int crossed = ca | cb | cc;
+        if (crossed == 0)
+        {
+            setupTriangle(a, b, c, chunk);
+            return;
+        }
+
+        SoftVertex polygon[2][9];
+        int count = 3;
+        polygon[0][0] = a;
+        polygon[0][1] = b;
+        polygon[0][2] = c;
+        int current = 0;
+        for (int plane = 0; plane < 6 && count >= 3; plane++)
+        {
+            if (!(crossed & (1 << plane)))
+                continue;
+            const SoftVertex* in = polygon[current];
+            SoftVertex* out = polygon[current ^ 1];
+            int n = 0;
+            for (int i = 0; i < count; i++)
+            {
+                const SoftVertex& p = in[i];
+                const SoftVertex& q = in[(i + 1) % count];
+                float dp = planeDistance(p.clip, plane), dq = planeDistance(q.clip, plane);
+                if (dp >= 0.0f)
+                    out[n++] = p;
+                if ((dp >= 0.0f) != (dq >= 0.0f))
+                {
+                    float t = dp / (dp - dq);
+                    out[n].clip = p.clip + (q.clip - p.clip) * t;
+                    out[n].color = p.color + (q.color - p.color) * t;
+                    n++;
+                }
+            }
+            count = n;
+            current ^= 1;
+        }
+        for (int i = 1; i + 1 < count; i++)
+            setupTriangle(polygon[current][0], polygon[current][i], polygon[current][i + 1], chunk);
+    }
+
+    // viewport transform, snapping, winding and binning of a triangle inside the view volume
+    // ------------------------------------------------------------------------
+    void setupTriangle(const SoftVertex& a, const SoftVertex& b, const SoftVertex& c, BinChunk& chunk)
+    {
+        const SoftVertex* v[3] = { &a, &b, &c };
+        SoftTriangle tri;
+        for (int i = 0; i < 3; i++)
+        {
+            const glm::vec4& clip = v[i]->clip;
+            float invW = 1.0f / std::max(clip.w, 1.0e-6f);
+            float sx = (clip.x * invW * 0.5f + 0.5f) * width;
+            float sy = (0.5f - clip.y * invW * 0.5f) * height;
+            tri.x[i] = (int32_t)std::floor(sx * SOFT_RASTER_SUBPIXEL + 0.5f);
+            tri.y[i] = (int32_t)std::floor(sy * SOFT_RASTER_SUBPIXEL + 0.5f);
+            tri.z[i] = clip.z * invW * 0.5f + 0.5f;
+            tri.invW[i] = invW;
+            tri.colorOverW[i] = v[i]->color * invW;
+        }
+        int64_t area = (int64_t)(tri.x[1] - tri.x[0]) * (tri.y[2] - tri.y[0]) - (int64_t)(tri.y[1] - tri.y[0]) * (tri.x[2] - tri.x[0]);
+        if (area == 0)
+            return;
+        if (area < 0)
+        {
+            std::swap(tri.x[1], tri.x[2]);
+            std::swap(tri.y[1], tri.y[2]);
+            std::swap(tri.z[1], tri.z[2]);
+            std::swap(tri.invW[1], tri.invW[2]);
+            std::swap(tri.colorOverW[1], tri.colorOverW[2]);
+            area = -area;
+        }
+        tri.area = area;
+
+        // pixel centers sit half a pixel into each pixel
+        const int half = SOFT_RASTER_SUBPIXEL / 2;
+        int32_t minXs = std::max(0, std::min(tri.x[0], std::min(tri.x[1], tri.x[2])));
+        int32_t minYs = std::max(0, std::min(tri.y[0], std::min(tri.y[1], tri.y[2])));
+        int32_t maxXs = std::max(tri.x[0], std::max(tri.x[1], tri.x[2]));
+        int32_t maxYs = std::max(tri.y[0], std::max(tri.y[1], tri.y[2]));
+        tri.minX = (minXs + SOFT_RASTER_SUBPIXEL - 1 - half) >> SOFT_RASTER_SUBPIXEL_BITS;
+        tri.minY = (minYs + SOFT_RASTER_SUBPIXEL - 1 - half) >> SOFT_RASTER_SUBPIXEL_BITS;
+        tri.maxX = maxXs >= half ? std::min(width - 1, (maxXs - half) >> SOFT_RASTER_SUBPIXEL_BITS) : -1;
+        tri.maxY = maxYs >= half ? std::min(height - 1, (maxYs - half) >> SOFT_RASTER_SUBPIXEL_BITS) : -1;
+        if (tri.minX > tri.maxX || tri.minY > tri.maxY)
+            return;
+
+        uint32_t index = (uint32_t)chunk.triangles.size();
+        chunk.triangles.push_back(tri);
+        for (int ty = tri.minY / SOFT_RASTER_TILE; ty <= tri.maxY / SOFT_RASTER_TILE; ty++)
+            for (int tx = tri.minX / SOFT_RASTER_TILE; tx <= tri.maxX / SOFT_RASTER_TILE; tx++)
+                chunk.bins[(size_t)ty * tilesX + tx].push_back(index);
+    }
+
+    // ------------------------------------------------------------------------
+    void rasterizeTile(size_t tile, size_t chunkCount)
+    {
+        int tx = (int)(tile % tilesX), ty = (int)(tile / tilesX);
+        int x0 = tx * SOFT_RASTER_TILE, y0 = ty * SOFT_RASTER_TILE;
+        int x1 = std::min(width, x0 + SOFT_RASTER_TILE) - 1, y1 = std::min(height, y0 + SOFT_RASTER_TILE) - 1;
+        size_t written = 0;
+        for (size_t c = 0; c < chunkCount; c++)
+        {
+            const BinChunk& chunk = chunks[c];
+            const std::vector<uint32_t>& bin = chunk.bins[tile];
+            for (size_t i = 0; i < bin.size(); i++)
+                written += drawTriangle(chunk.triangles[bin[i]], x0, y0, x1, y1);
+        }
+        tilePixels[tile] = written;
+    }
+
+    // walks the rectangle in 8x8 blocks: a block outside any edge is skipped, edges it lies inside are
+    // dropped, and the kernel tests the edges left for coverage and the covered pixels for depth;
+    // returns the pixels written
+    // ------------------------------------------------------------------------
+    size_t drawTriangle(const SoftTriangle& tri, int x0, int y0, int x1, int y1)
+    {
+        int minX = std::max(tri.minX, x0), maxX = std::min(tri.maxX, x1);
+        int minY = std::max(tri.minY, y0), maxY = std::min(tri.maxY, y1);
+        if (minX > maxX || minY > maxY)
+            return 0;
+
+        // blocks start at the corner of the rectangle and are cut short at its far sides
+        int blockX = minX, blockY = minY;
+
+        // edge i runs from vertex i to i + 1 and weighs the vertex opposite it;
+        // a shared edge is walked both ways, and only one direction includes it
+        int64_t firstEdge[3], stepX[3], stepY[3], bias[3];
+        int64_t px = (int64_t)blockX * SOFT_RASTER_SUBPIXEL + SOFT_RASTER_SUBPIXEL / 2;
+        int64_t py = (int64_t)blockY * SOFT_RASTER_SUBPIXEL + SOFT_RASTER_SUBPIXEL / 2;
+        for (int i = 0; i < 3; i++)
+        {
+            int j = (i + 1) % 3;
+            int64_t dx = tri.x[j] - tri.x[i], dy = tri.y[j] - tri.y[i];
+            bias[i] = (dy > 0 || (dy == 0 && dx > 0)) ? 0 : -1;
+            firstEdge[i] = dx * (py - tri.y[i]) - dy * (px - tri.x[i]) + bias[i];
+            stepX[i] = -dy * SOFT_RASTER_SUBPIXEL;
+            stepY[i] = dx * SOFT_RASTER_SUBPIXEL;
+        }
+
+        // depth is linear in window space; vertex k is weighed by edge k + 1
+        float invArea = 1.0f / (float)tri.area;
+        double invAreaExact = 1.0 / (double)tri.area;
+        float zStepX = 0.0f, zStepY = 0.0f;
+        for (int k = 0; k < 3; k++)
+        {
+            int e = (k + 1) % 3;
+            zStepX += (float)(stepX[e] * invAreaExact) * tri.z[k];
+            zStepY += (float)(stepY[e] * invAreaExact) * tri.z[k];
+        }
+
+        size_t written = 0;
+        for (int by = blockY; by <= maxY; by += RASTER_BLOCK)
+        {
+            int rows = std::min(RASTER_BLOCK, maxY - by + 1);
+            for (int bx = blockX; bx <= maxX; bx += RASTER_BLOCK)
+            {
+                int columns = std::min(RASTER_BLOCK, maxX - bx + 1);
+                int64_t edge[3];
+                RasterBlockEdges crossing;
+                crossing.count = 0;
+                bool outside = false;
+                for (int i = 0; i < 3 && !outside; i++)
+                {
+                    edge[i] = firstEdge[i] + stepX[i] * (bx - blockX) + stepY[i] * (by - blockY);
+                    // the edge function is linear, so its extremes over the block are at corners
+                    int64_t acrossX = stepX[i] * (columns - 1), acrossY = stepY[i] * (rows - 1);
+                    int64_t lowest = edge[i] + std::min<int64_t>(acrossX, 0) + std::min<int64_t>(acrossY, 0);
+                    int64_t highest = edge[i] + std::max<int64_t>(acrossX, 0) + std::max<int64_t>(acrossY, 0);
+                    if (highest < 0)
+                        outside = true;
+                    else if (lowest < 0)
+                    {
+                        // crossed by the edge, so |edge| is at most a block's worth of steps
+                        crossing.value[crossing.count] = (int32_t)edge[i];
+                        crossing.stepX[crossing.count] = (int32_t)stepX[i];
+                        crossing.stepY[crossing.count] = (int32_t)stepY[i];
+                        crossing.count++;
+                    }
+                }
+                if (outside)
+                    continue;
+                uint64_t covered = crossing.count > 0 ? blockCoverage(kernel, crossing, columns, rows) : blockMask(columns, rows);
+                if (!covered)
+                    continue;
+
+                float b[3];
+                for (int k = 0; k < 3; k++)
+                {
+                    int e = (k + 1) % 3;
+                    b[k] = (float)((edge[e] - bias[e]) * invAreaExact);
+                }
+                RasterBlockDepth plane;
+                plane.origin = b[0] * tri.z[0] + b[1] * tri.z[1] + b[2] * tri.z[2];
+                plane.dx = zStepX;
+                plane.dy = zStepY;
+                float* depthBlock = &depth[(size_t)by * width + bx];
+                uint64_t passed = blockDepthTest(kernel, covered, depthBlock, (size_t)width, plane, columns);
+
+                for (; passed; passed &= passed - 1)
+                {
+                    int bit = lowestBit(passed);
+                    int i = bit & (RASTER_BLOCK - 1), j = bit / RASTER_BLOCK;
+                    float e0 = (float)(edge[0] - bias[0] + stepX[0] * i + stepY[0] * j);
+                    float e1 = (float)(edge[1] - bias[1] + stepX[1] * i + stepY[1] * j);
+                    float e2 = (float)(edge[2] - bias[2] + stepX[2] * i + stepY[2] * j);
+                    shadePixel(tri, e1 * invArea, e2 * invArea, e0 * invArea, color.row(by + j) + (size_t)(bx + i) * 4);
+                    written++;
+                }
+            }
+        }
+        return written;
+    }
+
+    // color of one pixel that passed the depth test, from its barycentric weights
+    // ------------------------------------------------------------------------
+    static void shadePixel(const SoftTriangle& tri, float b0, float b1, float b2, uint8_t* rgba)
+    {
+        float w = 1.0f / (b0 * tri.invW[0] + b1 * tri.invW[1] + b2 * tri.invW[2]);
+        glm::vec3 c = (tri.colorOverW[0] * b0 + tri.colorOverW[1] * b1 + tri.colorOverW[2] * b2) * w;
+        rgba[0] = toByte(c.r);
+        rgba[1] = toByte(c.g);
+        rgba[2] = toByte(c.b);
+        rgba[3] = 255;
+    }
+};
+
+#endif
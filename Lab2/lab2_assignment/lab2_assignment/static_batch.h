@@ -0,0 +1,161 @@
+#pragma once
+//
+//  static_batch.h
+//  3D Object Drawing
+//
+//  Merges geometry that never moves relative to its parent into one vertex/index
+//  buffer with per-vertex color, so all of it renders with a single draw call.
+//
+
+#ifndef STATIC_BATCH_H
+#define STATIC_BATCH_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "mesh_cache.h"
+#include "cube_renderer.h"
+
+#include <vector>
+#include <cstddef>
+
+class StaticBatch
+{
+public:
+    unsigned int VAO = 0, VBO = 0, EBO = 0;
+    unsigned int indexCount = 0;
+    size_t rebuilds = 0;
+    AABB bounds = emptyAABB();  // of everything added, in the space the batch was baked in
+
+    // appends a mesh transformed by model; color, if given, replaces the mesh's own vertex colors
+    // ------------------------------------------------------------------------
+    void add(const Mesh& mesh, const glm::mat4& model, const glm::vec4* color = NULL)
+    {
+        const std::vector<float>& meshVertices = mesh.vertices;
+        const std::vector<unsigned int>& meshIndices = mesh.indices;
+        unsigned int base = (unsigned int)(vertices.size() / 6);
+        for (size_t v = 0; v + 5 < meshVertices.size(); v += 6)
+        {
+            glm::vec4 p = model * glm::vec4(meshVertices[v], meshVertices[v + 1], meshVertices[v + 2], 1.0f);
+            growAABB(bounds, glm::vec3(p));
+            vertices.push_back(p.x);
+            vertices.push_back(p.y);
+            vertices.push_back(p.z);
+            if (color)
+            {
+                vertices.push_back(color->r);
+                vertices.push_back(color->g);
+                vertices.push_back(color->b);
+            }
+            else
+            {
+                vertices.push_back(meshVertices[v + 3]);
+                vertices.push_back(meshVertices[v + 4]);
+                vertices.push_back(meshVertices[v + 5]);
+            }
+        }
+        for (size_t i = 0; i < meshIndices.size(); i++)
+            indices.push_back(base + meshIndices[i]);
+        dirty = true;
+    }
+    // appends every cube instance, using its model matrix and color
+    // ------------------------------------------------------------------------
+    void add(const Mesh& cube, const std::vector<CubeInstance>& instances)
+    {
+        for (size_t i = 0; i < instances.size(); i++)
+            add(cube, instances[i].model, &instances[i].color);
+    }
+    // uploads the merged geometry if anything was added since the last build
+    // ------------------------------------------------------------------------
+    void build()
+    {
+        if (!dirty)
+            return;
+
+        if (VAO == 0)
+        {
+            glGenVertexArrays(1, &VAO);
+            glGenBuffers(1, &VBO);
+            glGenBuffers(1, &EBO);
+        }
+
+        glState().bindVertexArray(VAO);
+
+        glState().bindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
+
+        glState().bindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+
+        // position attribute
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
+        glEnableVertexAttribArray(0);
+
+        // color attribute
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
+        glEnableVertexAttribArray(1);
+
+        glState().bindVertexArray(0);
+
+        indexCount = (unsigned int)indices.size();
+        dirty = false;
+        rebuilds++;
+    }
+    // one draw for the whole batch; the caller sets the parent transform as "model"
+    // ------------------------------------------------------------------------
+    void draw() const
+    {
+        if (indexCount == 0)
+            return;
+        glState().bindVertexArray(VAO);
+        glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, 0);
+    }
+    // the merged geometry as uploaded, for drawing without GL
+    // ------------------------------------------------------------------------
+    const std::vector<float>& cpuVertices() const
+    {
+        return vertices;
+    }
+    const std::vector<unsigned int>& cpuIndices() const
+    {
+        return indices;
+    }
+    // ------------------------------------------------------------------------
+    size_t vertexCount() const
+    {
+        return vertices.size() / 6;
+    }
+    size_t bytes() const
+    {
+        return vertices.size() * sizeof(float) + indices.size() * sizeof(unsigned int);
+    }
+    // ------------------------------------------------------------------------
+    void clear()
+    {
+        glState().deleteVertexArray(VAO);
+        glState().deleteBuffer(VBO);
+        glState().deleteBuffer(EBO);
+        VAO = VBO = EBO = 0;
+        indexCount = 0;
+        vertices.clear();
+        indices.clear();
+        bounds = emptyAABB();
+        dirty = false;
+    }
+
+private:
+    std::vector<float> vertices;
+    std::vector<unsigned int> indices;
+    bool dirty = false;
+};
+
+// a scene keeps one batch per anchor; this releases all of them
+// ------------------------------------------------------------------------
+inline void clearStaticBatches(std::vector<StaticBatch>& batches)
+{
+    for (size_t i = 0; i < batches.size(); i++)
+        batches[i].clear();
+    batches.clear();
+}
+
+#endif
@@ -0,0 +1,180 @@
+#pragma once
+//
+//  stream_buffer.h
+//  3D Object Drawing
+//
+//  Ring buffer for geometry that changes every frame. One buffer object is split
+//  into STREAM_FRAMES segments; a frame writes its segment through unsynchronized
+//  glMapBufferRange, and a fence placed at endFrame() tells a later frame when the
+//  GPU is done with it. Nothing is allocated and the driver never synchronizes
+//  implicitly; the only wait is an explicit (and counted) fence stall. Index
+//  data can share the ring: bind buffer as the element buffer and draw with the
+//  returned offset.
+//
+
+#ifndef STREAM_BUFFER_H
+#define STREAM_BUFFER_H
+
+#include <glad/glad.h>
+
+#include "gl_state_cache.h"
+
+#include <chrono>
+#include <cstring>
+#include <cstddef>
+#include <iostream>
+
+// frames the CPU may run ahead of the GPU before it waits on a fence
+const int STREAM_FRAMES = 3;
+
+class StreamBuffer
+{
+public:
+    unsigned int buffer = 0;
+    size_t segmentSize = 0;
+    // bytes written in the current frame and over every finished frame
+    size_t frameBytes = 0;
+    size_t totalBytes = 0;
+    size_t frames = 0;
+    // fence waits that were not already signaled, and the time spent in them
+    size_t stalls = 0;
+    double stallMs = 0.0;
+    size_t reallocations = 0;
+
+    // bytesPerFrame is the largest amount one frame is expected to write; more grows the buffer
+    // ------------------------------------------------------------------------
+    void init(size_t bytesPerFrame)
+    {
+        segmentSize = bytesPerFrame;
+        allocate();
+    }
+    // copies size bytes into this frame's segment and returns their offset in buffer
+    // ------------------------------------------------------------------------
+    size_t write(const void* data, size_t size, size_t alignment = 16)
+    {
+        size_t offset;
+        void* target = map(size, alignment, &offset);
+        if (!target)
+        {
+            std::cout << "ERROR::STREAM_BUFFER::MAP_FAILED " << size << " bytes" << std::endl;
+            return offset;
+        }
+        std::memcpy(target, data, size);
+        unmap();
+        return offset;
+    }
+    // maps size bytes of this frame's segment for writing; call unmap() before drawing
+    // ------------------------------------------------------------------------
+    void* map(size_t size, size_t alignment, size_t* offset)
+    {
+        size_t head = (used + alignment - 1) / alignment * alignment;
+        if (head + size > segmentSize)
+        {
+            // a frame outgrew its segment: start over with room for twice as much
+            size_t needed = head + size;
+            segmentSize = segmentSize * 2 > needed ? segmentSize * 2 : needed;
+            release();
+            allocate();
+            reallocations++;
+            head = 0;
+        }
+        if (!waited)
+            waitForSegment();
+
+        *offset = segment * segmentSize + head;
+        used = head + size;
+        frameBytes += size;
+
+        glState().bindBuffer(GL_ARRAY_BUFFER, buffer);
+        return glMapBufferRange(GL_ARRAY_BUFFER, *offset, size,
+            GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    }
+    void unmap()
+    {
+        glState().bindBuffer(GL_ARRAY_BUFFER, buffer);
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+    }
+    // fences the segment written this frame and moves on to the next one
+    // ------------------------------------------------------------------------
+    void endFrame()
+    {
+        if (frameBytes > 0)
+        {
+            fences[segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            segment = (segment + 1) % STREAM_FRAMES;
+            totalBytes += frameBytes;
+        }
+        frames++;
+        frameBytes = 0;
+        used = 0;
+        waited = false;
+    }
+    // ------------------------------------------------------------------------
+    void printStats() const
+    {
+        size_t n = frames > 0 ? frames : 1;
+        std::cout << "StreamBuffer: " << STREAM_FRAMES << " x " << segmentSize << " bytes, " << totalBytes / n
+            << " bytes streamed per frame, " << stalls << " fence stalls (" << stallMs << " ms), "
+            << reallocations << " reallocations" << std::endl;
+    }
+    // ------------------------------------------------------------------------
+    void clear()
+    {
+        release();
+        segmentSize = 0;
+    }
+
+private:
+    GLsync fences[STREAM_FRAMES] = {};
+    int segment = 0;
+    size_t used = 0;
+    bool waited = false;
+
+    // ------------------------------------------------------------------------
+    void allocate()
+    {
+        glGenBuffers(1, &buffer);
+        glState().bindBuffer(GL_ARRAY_BUFFER, buffer);
+        glBufferData(GL_ARRAY_BUFFER, segmentSize * STREAM_FRAMES, NULL, GL_STREAM_DRAW);
+    }
+    // the GL keeps a deleted buffer alive until the draws that read it have finished
+    void release()
+    {
+        for (int i = 0; i < STREAM_FRAMES; i++)
+        {
+            if (fences[i])
+                glDeleteSync(fences[i]);
+            fences[i] = 0;
+        }
+        if (buffer)
+            glState().deleteBuffer(buffer);
+        buffer = 0;
+        segment = 0;
+        used = 0;
+        waited = true;  // a fresh buffer has nothing in flight
+    }
+    // blocks until the GPU has consumed what was written to this segment STREAM_FRAMES frames ago
+    // ------------------------------------------------------------------------
+    void waitForSegment()
+    {
+        waited = true;
+        GLsync fence = fences[segment];
+        if (!fence)
+            return;
+        fences[segment] = 0;
+
+        GLenum status = glClientWaitSync(fence, 0, 0);
+        if (status == GL_TIMEOUT_EXPIRED)
+        {
+            stalls++;
+            std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+            do
+                status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+            while (status == GL_TIMEOUT_EXPIRED);
+            stallMs += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+        }
+        glDeleteSync(fence);
+    }
+};
+
+#endif
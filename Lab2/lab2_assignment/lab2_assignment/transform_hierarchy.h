@@ -0,0 +1,184 @@
+#pragma once
+//
+//  transform_hierarchy.h
+//  3D Object Drawing
+//
+//  Parent/child transforms with cached world matrices. Nodes live in parallel
+//  arrays in depth-first order (a parent always precedes its children), so
+//  update() is one linear pass that recomputes only nodes whose local TRS
+//  changed or whose parent's world matrix changed. When nothing was touched
+//  the pass is skipped entirely.
+//
+
+#ifndef TRANSFORM_HIERARCHY_H
+#define TRANSFORM_HIERARCHY_H
+
+#include <glm/glm.hpp>
+
+#include "transform_math.h"
+#include "profiler.h"
+
+#include <vector>
+#include <iostream>
+#include <cstddef>
+
+// nodes are addressed by their index in depth-first order; handles stay valid until clear()
+typedef unsigned int NodeHandle;
+const NodeHandle NO_NODE = 0xFFFFFFFFu;
+
+class TransformHierarchy
+{
+public:
+    // nodes recomputed by the last update() and over all updates
+    size_t updatedNodes = 0;
+    size_t totalUpdatedNodes = 0;
+    size_t updates = 0;
+    size_t skippedUpdates = 0;
+
+    // appends a node under parent (NO_NODE for a root); to keep depth-first order the parent
+    // must be the last node added or one of its ancestors
+    // ------------------------------------------------------------------------
+    NodeHandle addNode(NodeHandle parent, const glm::vec3& position, const glm::vec3& rotationDegrees = glm::vec3(0.0f),
+        const glm::vec3& scale = glm::vec3(1.0f), const glm::vec3& pivot = glm::vec3(0.0f))
+    {
+        while (!openPath.empty() && openPath.back() != parent)
+            openPath.pop_back();
+        if (parent != NO_NODE && openPath.empty())
+            std::cout << "WARNING::TRANSFORM_HIERARCHY::NOT_DEPTH_FIRST node " << parents.size()
+                << " added under " << parent << " after that subtree was closed" << std::endl;
+
+        NodeHandle node = (NodeHandle)parents.size();
+        parents.push_back(parent);
+        positions.push_back(position);
+        rotations.push_back(rotationDegrees);
+        scales.push_back(scale);
+        pivots.push_back(pivot);
+        locals.push_back(glm::mat4(1.0f));
+        worlds.push_back(glm::mat4(1.0f));
+        dirty.push_back(LOCAL_DIRTY);
+        changed.push_back(0);
+        openPath.push_back(node);
+        anyDirty = true;
+        return node;
+    }
+    // appends a node with a ready-made local matrix (e.g. from addCube); a later TRS setter replaces it
+    // ------------------------------------------------------------------------
+    NodeHandle addNode(NodeHandle parent, const glm::mat4& localMatrix)
+    {
+        NodeHandle node = addNode(parent, glm::vec3(0.0f));
+        locals[node] = localMatrix;
+        dirty[node] = WORLD_DIRTY;
+        return node;
+    }
+    // setters mark the node dirty only when the value actually changes
+    // ------------------------------------------------------------------------
+    void setPosition(NodeHandle node, const glm::vec3& position)
+    {
+        if (positions[node] != position)
+        {
+            positions[node] = position;
+            markDirty(node);
+        }
+    }
+    void setRotation(NodeHandle node, const glm::vec3& rotationDegrees)
+    {
+        if (rotations[node] != rotationDegrees)
+        {
+            rotations[node] = rotationDegrees;
+            markDirty(node);
+        }
+    }
+    void setScale(NodeHandle node, const glm::vec3& scale)
+    {
+        if (scales[node] != scale)
+        {
+            scales[node] = scale;
+            markDirty(node);
+        }
+    }
+    // recomputes dirty nodes and everything below them
+    // ------------------------------------------------------------------------
+    void update()
+    {
+        PROFILE_ZONE("TransformHierarchy::update");
+        updates++;
+        updatedNodes = 0;
+        if (!anyDirty)
+        {
+            skippedUpdates++;
+            return;
+        }
+        for (size_t i = 0; i < parents.size(); i++)
+        {
+            NodeHandle parent = parents[i];
+            bool parentChanged = parent != NO_NODE && changed[parent];
+            if (dirty[i] == LOCAL_DIRTY)
+                locals[i] = composeTRS(positions[i], rotations[i], scales[i], pivots[i]);
+            if (dirty[i] != CLEAN || parentChanged)
+            {
+                worlds[i] = parent == NO_NODE ? locals[i] : multiplyAffine(worlds[parent], locals[i]);
+                changed[i] = 1;
+                updatedNodes++;
+            }
+            else
+                changed[i] = 0;
+            dirty[i] = CLEAN;
+        }
+        totalUpdatedNodes += updatedNodes;
+        anyDirty = false;
+    }
+    // ------------------------------------------------------------------------
+    const glm::mat4& world(NodeHandle node) const
+    {
+        return worlds[node];
+    }
+    const glm::mat4& local(NodeHandle node) const
+    {
+        return locals[node];
+    }
+    NodeHandle parent(NodeHandle node) const
+    {
+        return parents[node];
+    }
+    size_t size() const
+    {
+        return parents.size();
+    }
+    // ------------------------------------------------------------------------
+    void printStats() const
+    {
+        size_t n = updates > 0 ? updates : 1;
+        std::cout << "TransformHierarchy: " << size() << " nodes, " << (double)totalUpdatedNodes / n << " recomputed per update, "
+            << skippedUpdates << " of " << updates << " updates skipped" << std::endl;
+    }
+    // ------------------------------------------------------------------------
+    void clear()
+    {
+        parents.clear(); positions.clear(); rotations.clear(); scales.clear(); pivots.clear();
+        locals.clear(); worlds.clear(); dirty.clear(); changed.clear(); openPath.clear();
+        anyDirty = false;
+    }
+
+private:
+    enum { CLEAN = 0, WORLD_DIRTY = 1, LOCAL_DIRTY = 2 };
+
+    std::vector<NodeHandle> parents;
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec3> rotations;   // degrees, applied X then Y then Z
+    std::vector<glm::vec3> scales;
+    std::vector<glm::vec3> pivots;
+    std::vector<glm::mat4> locals;
+    std::vector<glm::mat4> worlds;
+    std::vector<unsigned char> dirty;
+    std::vector<unsigned char> changed;     // world recomputed in the current pass
+    std::vector<NodeHandle> openPath;       // last node added and its ancestors
+    bool anyDirty = false;
+
+    void markDirty(NodeHandle node)
+    {
+        dirty[node] = LOCAL_DIRTY;
+        anyDirty = true;
+    }
+};
+
+#endif
@@ -0,0 +1,180 @@
+#pragma once
+//
+//  transform_math.h
+//  3D Object Drawing
+//
+//  Builds model matrices directly from position, Euler angles (degrees, applied
+//  X then Y then Z like the glm::rotate chain in drawCube), scale and pivot:
+//  one sine/cosine set and no intermediate matrix products.
+//
+
+#ifndef TRANSFORM_MATH_H
+#define TRANSFORM_MATH_H
+
+#include <glm/glm.hpp>
+
+#include <cmath>
+#include <cstddef>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TRANSFORM_MATH_SSE2 1
+#include <emmintrin.h>
+#include <xmmintrin.h>
+#endif
+
+// T(position) * Rx * Ry * Rz * S(scale) * T(pivot)
+// ------------------------------------------------------------------------
+inline glm::mat4 composeTRS(const glm::vec3& position, const glm::vec3& rotationDegrees,
+    const glm::vec3& scale, const glm::vec3& pivot = glm::vec3(0.0f))
+{
+    glm::vec3 angle = glm::radians(rotationDegrees);
+    float sa = std::sin(angle.x), ca = std::cos(angle.x);
+    float sb = std::sin(angle.y), cb = std::cos(angle.y);
+    float sc = std::sin(angle.z), cc = std::cos(angle.z);
+
+    glm::mat4 m;
+    m[0] = glm::vec4(cb * cc, ca * sc + sa * sb * cc, sa * sc - ca * sb * cc, 0.0f) * scale.x;
+    m[1] = glm::vec4(-cb * sc, ca * cc - sa * sb * sc, sa * cc + ca * sb * sc, 0.0f) * scale.y;
+    m[2] = glm::vec4(sb, -sa * cb, ca * cb, 0.0f) * scale.z;
+    m[3] = glm::vec4(position, 1.0f) + m[0] * pivot.x + m[1] * pivot.y + m[2] * pivot.z;
+    return m;
+}
+
+// parent * local for a local matrix whose last row is (0, 0, 0, 1)
+// ------------------------------------------------------------------------
+inline glm::mat4 multiplyAffine(const glm::mat4& parent, const glm::mat4& local)
+{
+    glm::mat4 m;
+    for (int j = 0; j < 3; j++)
+        m[j] = parent[0] * local[j].x + parent[1] * local[j].y + parent[2] * local[j].z;
+    m[3] = parent[0] * local[3].x + parent[1] * local[3].y + parent[2] * local[3].z + parent[3];
+    return m;
+}
+
+// parent * T(position) * Rx * Ry * Rz * S(scale) * T(pivot)
+// ------------------------------------------------------------------------
+inline glm::mat4 composeTRS(const glm::mat4& parent, const glm::vec3& position, const glm::vec3& rotationDegrees,
+    const glm::vec3& scale, const glm::vec3& pivot = glm::vec3(0.0f))
+{
+    return multiplyAffine(parent, composeTRS(position, rotationDegrees, scale, pivot));
+}
+
+// structure-of-arrays input for composeTRSBatch; every array holds count floats
+struct TRSArrays
+{
+    const float* positionX;
+    const float* positionY;
+    const float* positionZ;
+    const float* rotationX;     // degrees
+    const float* rotationY;
+    const float* rotationZ;
+    const float* scaleX;
+    const float* scaleY;
+    const float* scaleZ;
+};
+
+#ifdef TRANSFORM_MATH_SSE2
+// sine and cosine of four angles in radians (Cephes polynomials, |x| up to a few thousand)
+// ------------------------------------------------------------------------
+inline void sincos_ps(__m128 x, __m128* sinOut, __m128* cosOut)
+{
+    // quadrant q = round(x / (pi/2)), remainder r = x - q * pi/2 in extended precision
+    __m128i q = _mm_cvtps_epi32(_mm_mul_ps(x, _mm_set1_ps(0.63661977236758134f)));
+    __m128 qf = _mm_cvtepi32_ps(q);
+    __m128 r = _mm_sub_ps(x, _mm_mul_ps(qf, _mm_set1_ps(1.5703125f)));
+    r = _mm_sub_ps(r, _mm_mul_ps(qf, _mm_set1_ps(4.837512969970703125e-4f)));
+    r = _mm_sub_ps(r, _mm_mul_ps(qf, _mm_set1_ps(7.549789948768648e-8f)));
+
+    __m128 r2 = _mm_mul_ps(r, r);
+
+    __m128 s = _mm_set1_ps(-1.9515295891e-4f);
+    s = _mm_add_ps(_mm_mul_ps(s, r2), _mm_set1_ps(8.3321608736e-3f));
+    s = _mm_add_ps(_mm_mul_ps(s, r2), _mm_set1_ps(-1.6666654611e-1f));
+    s = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(s, r2), r), r);
+
+    __m128 c = _mm_set1_ps(2.443315711809948e-5f);
+    c = _mm_add_ps(_mm_mul_ps(c, r2), _mm_set1_ps(-1.388731625493765e-3f));
+    c = _mm_add_ps(_mm_mul_ps(c, r2), _mm_set1_ps(4.166664568298827e-2f));
+    c = _mm_mul_ps(_mm_mul_ps(c, r2), r2);
+    c = _mm_add_ps(_mm_sub_ps(c, _mm_mul_ps(r2, _mm_set1_ps(0.5f))), _mm_set1_ps(1.0f));
+
+    // odd quadrants swap sine and cosine; quadrants 2,3 negate sine, 1,2 negate cosine
+    __m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(q, _mm_set1_epi32(1)), _mm_set1_epi32(1)));
+    __m128 sinSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(q, _mm_set1_epi32(2)), 30));
+    __m128 cosSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(_mm_add_epi32(q, _mm_set1_epi32(1)), _mm_set1_epi32(2)), 30));
+
+    *sinOut = _mm_xor_ps(_mm_or_ps(_mm_and_ps(swap, c), _mm_andnot_ps(swap, s)), sinSign);
+    *cosOut = _mm_xor_ps(_mm_or_ps(_mm_and_ps(swap, s), _mm_andnot_ps(swap, c)), cosSign);
+}
+#endif
+
+// out[i] = parent * T(position[i]) * Rx * Ry * Rz * S(scale[i]) * T(pivot) for i < count;
+// the SSE2 path composes four matrices per iteration in SoA form
+// ------------------------------------------------------------------------
+inline void composeTRSBatch(const glm::mat4& parent, const TRSArrays& in, const glm::vec3& pivot, size_t count, glm::mat4* out)
+{
+    size_t i = 0;
+#ifdef TRANSFORM_MATH_SSE2
+    const __m128 toRadians = _mm_set1_ps(0.017453292519943295f);
+    const __m128 px = _mm_set1_ps(pivot.x), py = _mm_set1_ps(pivot.y), pz = _mm_set1_ps(pivot.z);
+
+    // parent[k][row] broadcast once for the whole batch
+    __m128 p[4][4];
+    for (int k = 0; k < 4; k++)
+        for (int row = 0; row < 4; row++)
+            p[k][row] = _mm_set1_ps(parent[k][row]);
+
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128 sa, ca, sb, cb, sc, cc;
+        sincos_ps(_mm_mul_ps(_mm_loadu_ps(in.rotationX + i), toRadians), &sa, &ca);
+        sincos_ps(_mm_mul_ps(_mm_loadu_ps(in.rotationY + i), toRadians), &sb, &cb);
+        sincos_ps(_mm_mul_ps(_mm_loadu_ps(in.rotationZ + i), toRadians), &sc, &cc);
+
+        __m128 sx = _mm_loadu_ps(in.scaleX + i);
+        __m128 sy = _mm_loadu_ps(in.scaleY + i);
+        __m128 sz = _mm_loadu_ps(in.scaleZ + i);
+
+        // local matrix L[row][col] for four instances, same terms as composeTRS
+        __m128 sasb = _mm_mul_ps(sa, sb), casb = _mm_mul_ps(ca, sb);
+        __m128 L[3][4];
+        L[0][0] = _mm_mul_ps(_mm_mul_ps(cb, cc), sx);
+        L[1][0] = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(ca, sc), _mm_mul_ps(sasb, cc)), sx);
+        L[2][0] = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(sa, sc), _mm_mul_ps(casb, cc)), sx);
+        L[0][1] = _mm_mul_ps(_mm_sub_ps(_mm_setzero_ps(), _mm_mul_ps(cb, sc)), sy);
+        L[1][1] = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(ca, cc), _mm_mul_ps(sasb, sc)), sy);
+        L[2][1] = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(sa, cc), _mm_mul_ps(casb, sc)), sy);
+        L[0][2] = _mm_mul_ps(sb, sz);
+        L[1][2] = _mm_mul_ps(_mm_sub_ps(_mm_setzero_ps(), _mm_mul_ps(sa, cb)), sz);
+        L[2][2] = _mm_mul_ps(_mm_mul_ps(ca, cb), sz);
+
+        __m128 pos[3] = { _mm_loadu_ps(in.positionX + i), _mm_loadu_ps(in.positionY + i), _mm_loadu_ps(in.positionZ + i) };
+        for (int row = 0; row < 3; row++)
+            L[row][3] = _mm_add_ps(pos[row], _mm_add_ps(_mm_add_ps(_mm_mul_ps(L[row][0], px), _mm_mul_ps(L[row][1], py)), _mm_mul_ps(L[row][2], pz)));
+
+        // world = parent * L, then transpose each column back to one matrix per instance
+        for (int col = 0; col < 4; col++)
+        {
+            __m128 r[4];
+            for (int row = 0; row < 4; row++)
+            {
+                r[row] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(p[0][row], L[0][col]), _mm_mul_ps(p[1][row], L[1][col])), _mm_mul_ps(p[2][row], L[2][col]));
+                if (col == 3)
+                    r[row] = _mm_add_ps(r[row], p[3][row]);
+            }
+            _MM_TRANSPOSE4_PS(r[0], r[1], r[2], r[3]);
+            for (int k = 0; k < 4; k++)
+                _mm_storeu_ps(&out[i + k][col][0], r[k]);
+        }
+    }
+#endif
+    for (; i < count; i++)
+    {
+        out[i] = composeTRS(parent,
+            glm::vec3(in.positionX[i], in.positionY[i], in.positionZ[i]),
+            glm::vec3(in.rotationX[i], in.rotationY[i], in.rotationZ[i]),
+            glm::vec3(in.scaleX[i], in.scaleY[i], in.scaleZ[i]), pivot);
+    }
+}
+
+#endif
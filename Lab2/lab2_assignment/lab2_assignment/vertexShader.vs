@@ -5,11 +5,17 @@ layout (location = 1) in vec3 aColor;
 out vec4 color;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+layout (std140) uniform FrameData
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 cameraPosition;
+    float time;
+};
 
 void main()
 {
-    gl_Position = projection * view * model * vec4(aPos, 1.0f);
+    gl_Position = viewProjection * model * vec4(aPos, 1.0f);
     color = vec4(aColor, 1.0f);
 }
@@ -0,0 +1,157 @@
+#pragma once
+//
+//  worker_pool.h
+//  3D Object Drawing
+//
+//  Fixed set of worker threads fed from one job queue. submit() queues a job
+//  and returns; wait() blocks until every queued job has run; parallelFor()
+//  spreads an index range over the workers and the calling thread and returns
+//  when all of it is done. Jobs must not touch GL: the context belongs to the
+//  render thread.
+//
+
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <algorithm>
+#include <cstddef>
+
+// threads used when start() is not told a count: every core but the caller's
+// ------------------------------------------------------------------------
+inline unsigned int defaultWorkerCount()
+{
+    unsigned int cores = std::thread::hardware_concurrency();
+    return cores > 1 ? cores - 1 : 1;
+}
+
+class WorkerPool
+{
+public:
+    size_t jobsRun = 0;
+
+    WorkerPool()
+    {
+    }
+    ~WorkerPool()
+    {
+        stop();
+    }
+    // ------------------------------------------------------------------------
+    void start(unsigned int threadCount = 0)
+    {
+        stop();
+        stopping = false;
+        if (threadCount == 0)
+            threadCount = defaultWorkerCount();
+        for (unsigned int i = 0; i < threadCount; i++)
+            threads.push_back(std::thread([this]() { run(); }));
+    }
+    // runs what is queued, then joins every thread
+    // ------------------------------------------------------------------------
+    void stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (size_t i = 0; i < threads.size(); i++)
+            threads[i].join();
+        threads.clear();
+    }
+    // ------------------------------------------------------------------------
+    void submit(std::function<void()> job)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            jobs.push_back(std::move(job));
+            unfinished++;
+        }
+        wake.notify_one();
+    }
+    // jobs queued or running
+    size_t pending()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return unfinished;
+    }
+    // ------------------------------------------------------------------------
+    void wait()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        idle.wait(lock, [this]() { return unfinished == 0; });
+    }
+    // calls body(i) for every i in [0, count), on the workers and the calling thread
+    // ------------------------------------------------------------------------
+    template <class Body>
+    void parallelFor(size_t count, Body body)
+    {
+        if (count == 0)
+            return;
+        std::atomic<size_t> next(0);
+        auto drain = [&]() {
+            for (size_t i = next++; i < count; i = next++)
+                body(i);
+        };
+        size_t helpers = std::min(threads.size(), count - 1);
+        std::atomic<size_t> running(helpers);
+        std::mutex doneMutex;
+        std::condition_variable done;
+        for (size_t h = 0; h < helpers; h++)
+            submit([&]() {
+                drain();
+                std::lock_guard<std::mutex> lock(doneMutex);
+                if (--running == 0)
+                    done.notify_one();
+            });
+        drain();
+        std::unique_lock<std::mutex> lock(doneMutex);
+        done.wait(lock, [&]() { return running == 0; });
+    }
+    // ------------------------------------------------------------------------
+    size_t size() const
+    {
+        return threads.size();
+    }
+
+private:
+    std::vector<std::thread> threads;
+    std::deque<std::function<void()>> jobs;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable idle;
+    size_t unfinished = 0;
+    bool stopping = false;
+
+    void run()
+    {
+        for (;;)
+        {
+            std::function<void()> job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [this]() { return stopping || !jobs.empty(); });
+                if (jobs.empty())
+                    return;
+                job = std::move(jobs.front());
+                jobs.pop_front();
+            }
+            job();
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                jobsRun++;
+                if (--unfinished == 0)
+                    idle.notify_all();
+            }
+        }
+    }
+};
+
+#endif